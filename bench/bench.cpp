@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aig.h"
+#include "anf.h"
+#include "bdd.h"
+#include "bitslice.h"
+#include "boolexpr_util.h"
+#include "interned_normal_form.h"
+#include "normal_form.h"
+#include "sha256.h"
+#include "tseitin.h"
+#include "word.h"
+
+/**
+ * Micro and macro benchmarks for every Bit backend. Each case runs until it
+ * has taken at least --min-time seconds, doubling the iteration count, and
+ * reports the mean time per call. Output is CSV (default) or JSON lines, one
+ * record per case, so runs of two revisions can be diffed or joined by name.
+ *
+ *   desha256_bench [--format=csv|json] [--filter=substring] [--min-time=seconds]
+ */
+
+namespace {
+
+struct Options {
+	std::string format = "csv";
+	std::string filter;
+	double min_time = 0.2;
+};
+
+Options options;
+
+template <typename T>
+void keep(const T& x) {
+	asm volatile("" : : "g"(&x) : "memory");
+}
+
+void report(const std::string& name, size_t iterations, double seconds) {
+	const double ns = seconds * 1e9 / iterations;
+	if (options.format == "json") {
+		std::cout << "{\"name\":\"" << name << "\",\"iterations\":" << iterations << ",\"ns_per_op\":" << ns << '}' << std::endl;
+	} else {
+		std::cout << name << ',' << iterations << ',' << ns << std::endl;
+	}
+}
+
+/** Times fn() until min_time has passed; the first call is a warm-up. */
+void run(const std::string& name, const std::function<void()>& fn) {
+	if (name.find(options.filter) == std::string::npos) {
+		return;
+	}
+
+	using clock = std::chrono::steady_clock;
+	fn();
+	for (size_t n = 1;; n *= 2) {
+		const clock::time_point start = clock::now();
+		for (size_t i = 0; i < n; i++) {
+			fn();
+		}
+		const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+		if (seconds >= options.min_time || n >= (size_t(1) << 30)) {
+			report(name, n, seconds);
+			return;
+		}
+	}
+}
+
+const char* adder_name(AdderKind kind) {
+	switch (kind) {
+		case AdderKind::ripple:
+			return "ripple";
+		case AdderKind::kogge_stone:
+			return "kogge_stone";
+		case AdderKind::brent_kung:
+			return "brent_kung";
+	}
+	return "";
+}
+
+/** Word-level operations on random operands. */
+template <typename T>
+void word_ops(const std::string& backend, const std::function<Bit<T>(std::mt19937_64&)>& random_bit) {
+	using word_t = Word<T, 32>;
+
+	std::mt19937_64 rng(1);
+	auto random_word = [&] {
+		word_t w;
+		for (size_t i = 0; i < 32; i++) {
+			w[i] = random_bit(rng);
+		}
+		return w;
+	};
+	const word_t x = random_word(), y = random_word(), z = random_word(), u = random_word(), v = random_word();
+
+	for (AdderKind kind : {AdderKind::ripple, AdderKind::kogge_stone, AdderKind::brent_kung}) {
+		run("word/add/" + std::string(adder_name(kind)) + "/" + backend, [&] { keep(word_t::add(x, y, kind)); });
+	}
+	run("word/sum5/" + backend, [&] { keep(word_t::sum({x, y, z, u, v})); });
+	run("word/rotate/" + backend, [&] { keep(x.rot_r(13)); });
+	run("word/ch/" + backend, [&] { keep(z ^ (x & (y ^ z))); });
+	run("word/maj/" + backend, [&] { keep((x & y) | (z & (x | y))); });
+	run("word/sigma0/" + backend, [&] { keep(x.rot_r(2) ^ x.rot_r(13) ^ x.rot_r(22)); });
+}
+
+/** Random clauses of `width` literals over N variables. */
+template <size_t N>
+spill_vector<Clause<N>> random_clauses(std::mt19937_64& rng, size_t count, size_t width) {
+	spill_vector<Clause<N>> r;
+	for (size_t k = 0; k < count; k++) {
+		std::bitset<N> set, clear;
+		for (size_t j = 0; j < width; j++) {
+			const size_t i = rng() % N;
+			if (!set[i] && !clear[i]) {
+				(rng() & 1 ? set : clear)[i] = true;
+			}
+		}
+		r.emplace_back(set, clear);
+	}
+	return r;
+}
+
+/**
+ * NormalForm product and absorption at fixed clause-set sizes. a & b takes
+ * the product of the DNFs and the absorbed concatenation of the CNFs, so
+ * leaving one side empty isolates the other.
+ */
+template <size_t N>
+void normal_form_ops() {
+	using nf_t = NormalForm<N>;
+
+	std::mt19937_64 rng(2);
+	for (size_t size : {16, 64, 256}) {
+		const auto a = random_clauses<N>(rng, size, 4), b = random_clauses<N>(rng, size, 4);
+		const std::string suffix = std::to_string(size) + "x" + std::to_string(size) + "/n" + std::to_string(N);
+
+		const nf_t pa({}, a), pb({}, b);
+		run("nf/product/" + suffix, [&] { keep(pa & pb); });
+
+		const nf_t ca(a, {}), cb(b, {});
+		run("nf/absorb/" + suffix, [&] { keep(ca & cb); });
+	}
+}
+
+/** One compression with a symbolic block, the context built afresh by make_context for every call. */
+template <typename T, size_t Rounds, typename Context>
+void compress(const std::string& backend, const std::function<Context()>& make_context, const std::function<Bit<T>(Context&, size_t)>& input) {
+	using sha_t = Sha256<T, Rounds>;
+
+	run("sha256/" + std::to_string(Rounds) + "/" + backend, [&] {
+		Context ctx = make_context();
+		typename sha_t::block_t block;
+		for (size_t i = 0; i < 512; i++) {
+			block[i] = input(ctx, i);
+		}
+		typename sha_t::state_t state = sha_t::InitialState();
+		sha_t::Compress(state, block);
+		keep(state);
+	});
+}
+
+/**
+ * One compression of a block built once, outside the timed region, for
+ * backends whose bits need no context. Filling 512 bits through
+ * std::function costs more than a whole concrete compression.
+ */
+template <typename T, size_t Rounds>
+void compress_block(const std::string& backend, const std::function<Bit<T>(size_t)>& input) {
+	using sha_t = Sha256<T, Rounds>;
+
+	typename sha_t::block_t block;
+	for (size_t i = 0; i < 512; i++) {
+		block[i] = input(i);
+	}
+	run("sha256/" + std::to_string(Rounds) + "/" + backend, [&] {
+		typename sha_t::state_t state = sha_t::InitialState();
+		sha_t::Compress(state, block);
+		keep(state);
+	});
+}
+
+template <typename T, size_t... Rounds>
+void compress_rounds(const std::string& backend, const std::function<Bit<T>(size_t)>& input) {
+	(compress_block<T, Rounds>(backend, input), ...);
+}
+
+/** Discards clauses; only the encoder's work is timed. */
+class NullSink : public ClauseSink {
+public:
+	void add_clause(const int*, size_t) override {}
+};
+
+void sha256_cases() {
+	std::mt19937_64 rng(3);
+	std::vector<bool> message(512);
+	for (size_t i = 0; i < 512; i++) {
+		message[i] = rng() & 1;
+	}
+
+	compress_rounds<bool, 8, 16, 32, 64>("bool", [&](size_t i) { return Bit<bool>(message[i]); });
+	compress_rounds<uint64_t, 8, 16, 32, 64>("bitslice64", [&](size_t i) { return Bit<uint64_t>(message[i] ? ~uint64_t(0) : 0); });
+
+	// Symbolic backends: the last `free` block bits are variables, the rest are the fixed message.
+	constexpr size_t free = 8;
+	auto fixed = [&](size_t i) { return i < 512 - free; };
+
+	boolexpr::Context bx_context;
+	compress_rounds<bx_t, 4, 8, 16>("bx_t", [&](size_t i) {
+		return fixed(i) ? (message[i] ? Bit<bx_t>::one() : Bit<bx_t>::zero()) : Bit<bx_t>(bx_context.get_var("x" + std::to_string(i)));
+	});
+	compress_rounds<NormalForm<free>, 4, 8, 16>("nf" + std::to_string(free), [&](size_t i) {
+		return fixed(i) ? Bit<NormalForm<free>>(NormalForm<free>(bool(message[i]))) : Bit<NormalForm<free>>(NormalForm<free>(i - (512 - free)));
+	});
+	compress_rounds<InternedNormalForm<free>, 4, 8, 16>("nf" + std::to_string(free) + "_interned", [&](size_t i) {
+		using T = InternedNormalForm<free>;
+		return fixed(i) ? Bit<T>(T(bool(message[i]))) : Bit<T>(T(i - (512 - free)));
+	});
+	compress_rounds<Anf, 8, 16>("anf", [&](size_t i) { return fixed(i) ? Bit<Anf>(Anf(bool(message[i]))) : Bit<Anf>(Anf(i - (512 - free))); });
+
+	auto aig = std::function<std::unique_ptr<Aig>()>([] { return std::make_unique<Aig>(); });
+	auto aig_input = std::function<Bit<AigLit>(std::unique_ptr<Aig>&, size_t)>([&](std::unique_ptr<Aig>& ctx, size_t i) { return Bit<AigLit>(ctx->input(i)); });
+	compress<AigLit, 16>("aig", aig, aig_input);
+	compress<AigLit, 64>("aig", aig, aig_input);
+
+	auto bdd = std::function<std::unique_ptr<Bdd>()>([] { return std::make_unique<Bdd>(); });
+	auto bdd_input = std::function<Bit<BddRef>(std::unique_ptr<Bdd>&, size_t)>([&](std::unique_ptr<Bdd>& ctx, size_t i) {
+		return fixed(i) ? (message[i] ? Bit<BddRef>::one() : Bit<BddRef>::zero()) : Bit<BddRef>(ctx->input(i - (512 - free)));
+	});
+	compress<BddRef, 16>("bdd", bdd, bdd_input);
+	compress<BddRef, 64>("bdd", bdd, bdd_input);
+
+	NullSink sink;
+	auto cnf = std::function<std::unique_ptr<CnfEncoder>()>([&] { return std::make_unique<CnfEncoder>(sink, 512); });
+	auto cnf_input = std::function<Bit<CnfLit>(std::unique_ptr<CnfEncoder>&, size_t)>([&](std::unique_ptr<CnfEncoder>& ctx, size_t i) { return Bit<CnfLit>(ctx->input(i)); });
+	compress<CnfLit, 16>("cnf", cnf, cnf_input);
+	compress<CnfLit, 64>("cnf", cnf, cnf_input);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg.rfind("--format=", 0) == 0) {
+			options.format = arg.substr(9);
+		} else if (arg.rfind("--filter=", 0) == 0) {
+			options.filter = arg.substr(9);
+		} else if (arg.rfind("--min-time=", 0) == 0) {
+			options.min_time = std::stod(arg.substr(11));
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--format=csv|json] [--filter=substring] [--min-time=seconds]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.format == "csv") {
+		std::cout << "name,iterations,ns_per_op" << std::endl;
+	}
+
+	word_ops<bool>("bool", [](std::mt19937_64& rng) { return Bit<bool>(rng() & 1); });
+	word_ops<uint64_t>("bitslice64", [](std::mt19937_64& rng) { return Bit<uint64_t>(rng()); });
+	normal_form_ops<64>();
+	normal_form_ops<640>();
+	sha256_cases();
+
+	return 0;
+}
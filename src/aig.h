@@ -0,0 +1,215 @@
+#ifndef DESHA256_AIG_H_
+#define DESHA256_AIG_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bit.h"
+#include "context_stack.h"
+
+/** Literal of an And-Inverter Graph: node index times two, plus one if complemented. */
+class AigLit {
+public:
+	constexpr AigLit() : lit_(0) {}
+	constexpr explicit AigLit(uint32_t lit) : lit_(lit) {}
+	constexpr AigLit(uint32_t var, bool negated) : lit_((var << 1) | (negated ? 1 : 0)) {}
+
+	constexpr uint32_t raw() const { return lit_; }
+	constexpr uint32_t var() const { return lit_ >> 1; }
+	constexpr bool negated() const { return lit_ & 1; }
+	constexpr bool is_const() const { return var() == 0; }
+
+	constexpr AigLit operator~() const { return AigLit(lit_ ^ 1); }
+
+	constexpr bool operator==(const AigLit& other) const { return lit_ == other.lit_; }
+	constexpr bool operator!=(const AigLit& other) const { return lit_ != other.lit_; }
+	constexpr bool operator<(const AigLit& other) const { return lit_ < other.lit_; }
+
+	static constexpr AigLit zero() { return AigLit(0); }
+	static constexpr AigLit one() { return AigLit(1); }
+
+private:
+	uint32_t lit_;
+};
+
+/**
+ * Structurally hashed And-Inverter Graph. Node 0 is the constant, every other
+ * node is a primary input or a two-input AND; nodes are created after their
+ * fanins, so node order is a topological order.
+ *
+ * Bit<AigLit> builds into the graph returned by Aig::current(), which is the
+ * most recently constructed live Aig (or a process-wide default).
+ */
+class Aig : public ContextStack<Aig> {
+public:
+	Aig() {
+		nodes_.push_back({0, 0});
+		table_.assign(1 << 10, 0);
+	}
+
+	Aig(const Aig&) = delete;
+	Aig& operator=(const Aig&) = delete;
+
+	static Aig& current() {
+		if (!innermost()) {
+			static Aig global;
+			return global;
+		}
+		return *innermost();
+	}
+
+	/** The i-th primary input, created on first use. */
+	AigLit input(size_t i) {
+		if (i >= inputs_.size()) {
+			inputs_.resize(i + 1, 0);
+		}
+		if (!inputs_[i]) {
+			inputs_[i] = static_cast<uint32_t>(nodes_.size());
+			nodes_.push_back({kInputMark, static_cast<uint32_t>(i)});
+		}
+		return AigLit(inputs_[i], false);
+	}
+
+	AigLit and_(AigLit a, AigLit b) {
+		if (b < a) {
+			std::swap(a, b);
+		}
+		if (a == AigLit::zero() || a == ~b) {
+			return AigLit::zero();
+		}
+		if (a == AigLit::one() || a == b) {
+			return b;
+		}
+
+		const size_t mask = table_.size() - 1;
+		size_t h = hash(a, b) & mask;
+		while (table_[h]) {
+			const Node& n = nodes_[table_[h]];
+			if (n.fanin0 == a.raw() && n.fanin1 == b.raw()) {
+				return AigLit(table_[h], false);
+			}
+			h = (h + 1) & mask;
+		}
+
+		const uint32_t var = static_cast<uint32_t>(nodes_.size());
+		nodes_.push_back({a.raw(), b.raw()});
+		table_[h] = var;
+		ands_++;
+		if (2 * ands_ > table_.size()) {
+			rehash(table_.size() * 2);
+		}
+		return AigLit(var, false);
+	}
+
+	AigLit or_(AigLit a, AigLit b) {
+		return ~and_(~a, ~b);
+	}
+
+	AigLit xor_(AigLit a, AigLit b) {
+		if (a.is_const()) {
+			return a.negated() ? ~b : b;
+		}
+		if (b.is_const()) {
+			return b.negated() ? ~a : a;
+		}
+		if (a == b) {
+			return AigLit::zero();
+		}
+		if (a == ~b) {
+			return AigLit::one();
+		}
+		return or_(and_(a, ~b), and_(~a, b));
+	}
+
+	AigLit ite(AigLit s, AigLit d1, AigLit d0) {
+		if (s.is_const()) {
+			return s.negated() ? d1 : d0;
+		}
+		if (d1 == d0) {
+			return d1;
+		}
+		return or_(and_(s, d1), and_(~s, d0));
+	}
+
+	/** Number of nodes, including the constant and the inputs. */
+	size_t size() const { return nodes_.size(); }
+	size_t num_ands() const { return ands_; }
+	size_t num_inputs() const { return nodes_.size() - ands_ - 1; }
+
+	/** Bytes held by the node array and the unique table. */
+	size_t memory() const {
+		return nodes_.capacity() * sizeof(Node) + table_.capacity() * sizeof(uint32_t) + inputs_.capacity() * sizeof(uint32_t);
+	}
+
+	bool is_input(uint32_t var) const { return var != 0 && nodes_[var].fanin0 == kInputMark; }
+	bool is_and(uint32_t var) const { return var != 0 && nodes_[var].fanin0 != kInputMark; }
+	size_t input_index(uint32_t var) const { return nodes_[var].fanin1; }
+	AigLit fanin0(uint32_t var) const { return AigLit(nodes_[var].fanin0); }
+	AigLit fanin1(uint32_t var) const { return AigLit(nodes_[var].fanin1); }
+
+private:
+	struct Node {
+		uint32_t fanin0, fanin1;
+	};
+
+	static constexpr uint32_t kInputMark = ~uint32_t(0);
+
+	static size_t hash(AigLit a, AigLit b) {
+		uint64_t h = (uint64_t(a.raw()) << 32) | b.raw();
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+
+	void rehash(size_t buckets) {
+		table_.assign(buckets, 0);
+		const size_t mask = buckets - 1;
+		for (uint32_t var = 1; var < nodes_.size(); var++) {
+			if (!is_and(var)) {
+				continue;
+			}
+			size_t h = hash(fanin0(var), fanin1(var)) & mask;
+			while (table_[h]) {
+				h = (h + 1) & mask;
+			}
+			table_[h] = var;
+		}
+	}
+
+private:
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> table_;
+	std::vector<uint32_t> inputs_;
+	size_t ands_ = 0;
+};
+
+template <>
+inline AigLit Bit<AigLit>::raw_zero() { return AigLit::zero(); }
+
+template <>
+inline AigLit Bit<AigLit>::raw_one() { return AigLit::one(); }
+
+template <>
+inline AigLit Bit<AigLit>::raw_not(const AigLit& a) { return ~a; }
+
+template <>
+inline AigLit Bit<AigLit>::raw_and(const AigLit& a, const AigLit& b) { return Aig::current().and_(a, b); }
+
+template <>
+inline AigLit Bit<AigLit>::raw_or(const AigLit& a, const AigLit& b) { return Aig::current().or_(a, b); }
+
+template <>
+inline AigLit Bit<AigLit>::raw_xor(const AigLit& a, const AigLit& b) { return Aig::current().xor_(a, b); }
+
+template <>
+inline AigLit Bit<AigLit>::raw_ite(const AigLit& s, const AigLit& d1, const AigLit& d0) { return Aig::current().ite(s, d1, d0); }
+
+/** Logarithmic-depth adders for a few more ands; the graph is meant to be analysed and evaluated, not just counted. */
+template <>
+struct AdderTraits<AigLit> {
+	static constexpr AdderKind kind = AdderKind::brent_kung;
+};
+
+#endif  // !DESHA256_AIG_H_
@@ -0,0 +1,223 @@
+#ifndef DESHA256_ANF_H_
+#define DESHA256_ANF_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "bit.h"
+
+/**
+ * Algebraic Normal Form (Zhegalkin polynomial): an XOR of monomials, each an
+ * AND of distinct input variables. A monomial is a sorted variable list and a
+ * polynomial is a sorted list of distinct monomials, ordered by degree first;
+ * the empty monomial is the constant 1 and the empty polynomial is 0. The
+ * whole polynomial lives in one flat array of [degree, var...] records.
+ *
+ * XOR is a linear merge that cancels equal monomials, AND multiplies every
+ * pair of monomials and cancels duplicates by parity. When max_degree() is
+ * set, monomials above it are dropped; since a monomial product never has a
+ * lower degree than its factors, the result is then exactly the part of the
+ * true polynomial up to that degree, and truncated() tells if anything was cut.
+ */
+class Anf {
+public:
+	Anf() {}
+	Anf(bool b) {
+		if (b) {
+			data_.push_back(0);
+			size_ = 1;
+		}
+	}
+	Anf(size_t i) : data_{1, static_cast<uint32_t>(i)}, size_(1) {}
+
+	Anf operator~() const {
+		return *this ^ Anf(true);
+	}
+
+	Anf operator^(const Anf& other) const {
+		Anf r;
+		r.truncated_ = truncated_ || other.truncated_;
+		r.data_.reserve(data_.size() + other.data_.size());
+
+		const uint32_t *i = data_.data(), *i_end = i + data_.size();
+		const uint32_t *j = other.data_.data(), *j_end = j + other.data_.size();
+		while (i != i_end && j != j_end) {
+			const int c = compare(i, j);
+			if (c < 0) {
+				i = r.append(i);
+			} else if (c > 0) {
+				j = r.append(j);
+			} else {
+				i += *i + 1;
+				j += *j + 1;
+			}
+		}
+		while (i != i_end) {
+			i = r.append(i);
+		}
+		while (j != j_end) {
+			j = r.append(j);
+		}
+		return r;
+	}
+
+	Anf operator&(const Anf& other) const {
+		if (other.is_zero()) {
+			return other;
+		}
+		if (is_zero()) {
+			return *this;
+		}
+		// A truncated 1 still stands for cut terms, so its flag carries over.
+		if (is_one()) {
+			Anf r = other;
+			r.truncated_ = r.truncated_ || truncated_;
+			return r;
+		}
+		if (other.is_one()) {
+			Anf r = *this;
+			r.truncated_ = r.truncated_ || other.truncated_;
+			return r;
+		}
+
+		Anf r;
+		r.truncated_ = truncated_ || other.truncated_;
+
+		// Products go to a scratch arena, then get sorted by offset and cancelled by parity.
+		std::vector<uint32_t> arena;
+		std::vector<uint32_t> offsets;
+		for (const uint32_t* x = data_.data(); x != data_.data() + data_.size(); x += *x + 1) {
+			for (const uint32_t* y = other.data_.data(); y != other.data_.data() + other.data_.size(); y += *y + 1) {
+				if (x[0] + y[0] > max_degree_ && union_size(x, y) > max_degree_) {
+					r.truncated_ = true;
+					continue;
+				}
+				const size_t at = arena.size();
+				arena.resize(at + 1 + x[0] + y[0]);
+				const uint32_t* end = std::set_union(x + 1, x + 1 + x[0], y + 1, y + 1 + y[0], &arena[at + 1]);
+				arena.resize(end - arena.data());
+				arena[at] = static_cast<uint32_t>(arena.size() - at - 1);
+				offsets.push_back(static_cast<uint32_t>(at));
+			}
+		}
+
+		std::sort(offsets.begin(), offsets.end(), [&arena](uint32_t a, uint32_t b) {
+			return compare(&arena[a], &arena[b]) < 0;
+		});
+		for (size_t i = 0; i < offsets.size();) {
+			size_t j = i + 1;
+			while (j < offsets.size() && compare(&arena[offsets[j]], &arena[offsets[i]]) == 0) {
+				j++;
+			}
+			if ((j - i) & 1) {
+				r.append(&arena[offsets[i]]);
+			}
+			i = j;
+		}
+		return r;
+	}
+
+	Anf operator|(const Anf& other) const {
+		return *this ^ other ^ (*this & other);
+	}
+
+	/** Algebraic degree; 0 for constants. Monomials are ordered by degree, so it is the last one's. */
+	size_t degree() const {
+		return size_ ? data_[last_] : 0;
+	}
+
+	/** Number of monomials. */
+	size_t size() const {
+		return size_;
+	}
+
+	bool truncated() const {
+		return truncated_;
+	}
+
+	/** Calls fn(vars, degree) for every monomial, in order. */
+	template <typename Fn>
+	void for_each_monomial(Fn fn) const {
+		for (const uint32_t* x = data_.data(); x != data_.data() + data_.size(); x += *x + 1) {
+			fn(x + 1, static_cast<size_t>(x[0]));
+		}
+	}
+
+	static size_t max_degree() { return max_degree_; }
+	static void set_max_degree(size_t d) { max_degree_ = d; }
+
+	~Anf() {}
+
+private:
+	bool is_zero() const { return size_ == 0; }
+	bool is_one() const { return size_ == 1 && data_[0] == 0; }
+
+	/** Copies the monomial at x and returns the one after it. */
+	const uint32_t* append(const uint32_t* x) {
+		last_ = data_.size();
+		data_.insert(data_.end(), x, x + x[0] + 1);
+		size_++;
+		return x + x[0] + 1;
+	}
+
+	/** Degree first, then variables lexicographically. */
+	static int compare(const uint32_t* x, const uint32_t* y) {
+		if (x[0] != y[0]) {
+			return x[0] < y[0] ? -1 : 1;
+		}
+		for (uint32_t k = 1; k <= x[0]; k++) {
+			if (x[k] != y[k]) {
+				return x[k] < y[k] ? -1 : 1;
+			}
+		}
+		return 0;
+	}
+
+	/** Degree of x * y, counted without building it; stops once max_degree() is exceeded. */
+	static size_t union_size(const uint32_t* x, const uint32_t* y) {
+		size_t n = 0;
+		const uint32_t *i = x + 1, *i_end = i + x[0];
+		const uint32_t *j = y + 1, *j_end = j + y[0];
+		while (i != i_end && j != j_end && n <= max_degree_) {
+			if (*i < *j) {
+				++i;
+			} else if (*j < *i) {
+				++j;
+			} else {
+				++i, ++j;
+			}
+			n++;
+		}
+		return n + (i_end - i) + (j_end - j);
+	}
+
+private:
+	inline static size_t max_degree_ = std::numeric_limits<size_t>::max();
+
+	std::vector<uint32_t> data_;
+	size_t size_ = 0;
+	size_t last_ = 0;
+	bool truncated_ = false;
+};
+
+template <>
+inline Anf Bit<Anf>::raw_zero() { return Anf(false); }
+
+template <>
+inline Anf Bit<Anf>::raw_one() { return Anf(true); }
+
+template <>
+inline Anf Bit<Anf>::raw_not(const Anf& a) { return ~a; }
+
+template <>
+inline Anf Bit<Anf>::raw_ite(const Anf& s, const Anf& d1, const Anf& d0) { return d0 ^ (s & (d1 ^ d0)); }
+
+template <>
+struct BitMetrics<Anf> {
+	static constexpr const char* unit = "monomials";
+	static size_t size(const Anf& x) { return x.size(); }
+};
+
+#endif  // !DESHA256_ANF_H_
@@ -0,0 +1,664 @@
+#ifndef DESHA256_BDD_H_
+#define DESHA256_BDD_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bit.h"
+#include "context_stack.h"
+
+class Bdd;
+
+/**
+ * Counted reference to a BDD node. Nodes 0 and 1 are the constants and need
+ * no manager; every other reference keeps its node alive in its Bdd.
+ */
+class BddRef {
+public:
+	BddRef() : mgr_(nullptr), node_(0) {}
+	BddRef(Bdd* mgr, uint32_t node);
+	BddRef(const BddRef& other) : BddRef(other.mgr_, other.node_) {}
+	BddRef(BddRef&& other) noexcept : mgr_(other.mgr_), node_(other.node_) {
+		other.mgr_ = nullptr;
+		other.node_ = 0;
+	}
+
+	BddRef& operator=(BddRef other) noexcept {
+		std::swap(mgr_, other.mgr_);
+		std::swap(node_, other.node_);
+		return *this;
+	}
+
+	uint32_t node() const { return node_; }
+	Bdd* manager() const { return mgr_; }
+	bool is_const() const { return node_ < 2; }
+
+	bool operator==(const BddRef& other) const { return node_ == other.node_; }
+	bool operator!=(const BddRef& other) const { return node_ != other.node_; }
+
+	static BddRef zero() { return BddRef(); }
+	static BddRef one() { return BddRef(nullptr, 1); }
+
+	~BddRef();
+
+private:
+	Bdd* mgr_;
+	uint32_t node_;
+};
+
+/** Thrown by a Bdd operation that would need more live nodes than the configured limit. */
+class BddNodeLimit : public std::runtime_error {
+public:
+	explicit BddNodeLimit(size_t limit) : std::runtime_error("BDD node limit of " + std::to_string(limit) + " reached") {}
+};
+
+/** Exact unbounded count, as returned by Bdd::sat_count(). */
+class SatCount {
+public:
+	SatCount(uint32_t n = 0) {
+		if (n) {
+			limbs_.push_back(n);
+		}
+	}
+
+	SatCount& operator+=(const SatCount& other) {
+		limbs_.resize(std::max(limbs_.size(), other.limbs_.size()), 0);
+		uint64_t carry = 0;
+		for (size_t i = 0; i < limbs_.size(); i++) {
+			carry += uint64_t(limbs_[i]) + (i < other.limbs_.size() ? other.limbs_[i] : 0);
+			limbs_[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		if (carry) {
+			limbs_.push_back(static_cast<uint32_t>(carry));
+		}
+		return *this;
+	}
+
+	/** Multiplies by 2^k. */
+	SatCount& shl(size_t k) {
+		if (limbs_.empty()) {
+			return *this;
+		}
+		limbs_.insert(limbs_.begin(), k / 32, 0);
+		if (k % 32) {
+			uint32_t carry = 0;
+			for (uint32_t& limb : limbs_) {
+				const uint32_t next = limb >> (32 - k % 32);
+				limb = (limb << (k % 32)) | carry;
+				carry = next;
+			}
+			if (carry) {
+				limbs_.push_back(carry);
+			}
+		}
+		return *this;
+	}
+
+	double to_double() const {
+		double r = 0;
+		for (size_t i = limbs_.size(); i-- > 0;) {
+			r = r * 4294967296.0 + limbs_[i];
+		}
+		return r;
+	}
+
+	std::string to_string() const {
+		std::vector<uint32_t> n = limbs_;
+		std::string digits;
+		while (!n.empty()) {
+			uint64_t rem = 0;
+			for (size_t i = n.size(); i-- > 0;) {
+				const uint64_t cur = (rem << 32) | n[i];
+				n[i] = static_cast<uint32_t>(cur / 10);
+				rem = cur % 10;
+			}
+			digits += static_cast<char>('0' + rem);
+			while (!n.empty() && n.back() == 0) {
+				n.pop_back();
+			}
+		}
+		if (digits.empty()) {
+			digits = "0";
+		}
+		std::reverse(digits.begin(), digits.end());
+		return digits;
+	}
+
+private:
+	std::vector<uint32_t> limbs_;
+};
+
+/**
+ * Reduced ordered BDD manager: per-variable unique tables, a computed cache
+ * for if-then-else, reference counting with deferred garbage collection, and
+ * variable reordering by sifting.
+ *
+ * Unreferenced nodes stay in the unique table until the next collection and
+ * are revived if rebuilt meanwhile. Collection and reordering only run on
+ * entry to a top-level operation, when the node count passes a threshold that
+ * then adapts to the live size. An operation that runs into node_limit() is
+ * retried once after a collection and then throws BddNodeLimit; the manager
+ * stays consistent and the partial result becomes garbage.
+ *
+ * Bit<BddRef> builds into Bdd::current(), the most recently constructed live
+ * manager (or a process-wide default).
+ */
+class Bdd : public ContextStack<Bdd> {
+public:
+	Bdd() {
+		nodes_.push_back({kTerminal, 0, 0, 0, kNil});
+		nodes_.push_back({kTerminal, 1, 1, 0, kNil});
+		cache_.resize(kCacheSize);
+	}
+
+	Bdd(const Bdd&) = delete;
+	Bdd& operator=(const Bdd&) = delete;
+
+	static Bdd& current() {
+		if (!innermost()) {
+			static Bdd global;
+			return global;
+		}
+		return *innermost();
+	}
+
+	/** The projection on input i; inputs are created on first use, at the bottom of the order. */
+	BddRef input(size_t i) {
+		while (num_vars() <= i) {
+			const uint32_t v = static_cast<uint32_t>(num_vars());
+			var2level_.push_back(v);
+			level2var_.push_back(v);
+			tables_.emplace_back();
+		}
+		return wrap(mk(static_cast<uint32_t>(i), 0, 1));
+	}
+
+	BddRef and_(const BddRef& a, const BddRef& b) { return top(a.node(), b.node(), 0); }
+	BddRef or_(const BddRef& a, const BddRef& b) { return top(a.node(), 1, b.node()); }
+	BddRef xor_(const BddRef& a, const BddRef& b) {
+		const BddRef nb = not_(b);
+		return top(a.node(), nb.node(), b.node());
+	}
+	BddRef not_(const BddRef& a) { return top(a.node(), 0, 1); }
+	BddRef ite(const BddRef& s, const BddRef& d1, const BddRef& d0) { return top(s.node(), d1.node(), d0.node()); }
+
+	/** Number of assignments to all num_vars() inputs that satisfy f. */
+	SatCount sat_count(const BddRef& f) const {
+		std::unordered_map<uint32_t, SatCount> memo;
+		SatCount r = count_rec(f.node(), memo);
+		return r.shl(level(f.node()));
+	}
+
+	/** Nodes reachable from f, constants included. */
+	size_t node_count(const BddRef& f) const {
+		std::vector<uint32_t> stack{f.node()};
+		std::vector<char> seen(nodes_.size(), 0);
+		size_t n = 0;
+		while (!stack.empty()) {
+			const uint32_t u = stack.back();
+			stack.pop_back();
+			if (seen[u]) {
+				continue;
+			}
+			seen[u] = 1;
+			n++;
+			if (u >= 2) {
+				stack.push_back(nodes_[u].low);
+				stack.push_back(nodes_[u].high);
+			}
+		}
+		return n;
+	}
+
+	/** Evaluates f under an assignment indexed by input. */
+	bool eval(const BddRef& f, const std::vector<bool>& inputs) const {
+		uint32_t u = f.node();
+		while (u >= 2) {
+			u = inputs[nodes_[u].var] ? nodes_[u].high : nodes_[u].low;
+		}
+		return u == 1;
+	}
+
+	size_t num_vars() const { return var2level_.size(); }
+
+	/** Allocated nodes, including unreclaimed garbage and the constants. */
+	size_t size() const { return nodes_.size() - free_count_; }
+
+	size_t node_limit() const { return node_limit_; }
+	void set_node_limit(size_t limit) { node_limit_ = limit; }
+
+	/** Sift automatically whenever the live size has doubled since the last reordering. */
+	void set_auto_reorder(bool enabled) { auto_reorder_ = enabled; }
+
+	/** Position of input var in the current order, 0 being the top. */
+	size_t level_of(size_t var) const { return var2level_[var]; }
+
+	size_t gc_runs() const { return gc_runs_; }
+	size_t reorder_runs() const { return reorder_runs_; }
+
+	/** Frees every unreferenced node and clears the computed cache. */
+	void collect() {
+		std::vector<uint32_t> dead;
+		for (uint32_t u = 2; u < nodes_.size(); u++) {
+			if (nodes_[u].var != kFree && nodes_[u].ref == 0) {
+				dead.push_back(u);
+			}
+		}
+		while (!dead.empty()) {
+			const uint32_t u = dead.back();
+			dead.pop_back();
+			for (uint32_t c : {nodes_[u].low, nodes_[u].high}) {
+				if (c >= 2 && --nodes_[c].ref == 0) {
+					dead.push_back(c);
+				}
+			}
+			release(u);
+		}
+		clear_cache();
+		gc_runs_++;
+	}
+
+	/**
+	 * Rudell's sifting: every variable, largest level first, is moved through
+	 * the whole order by adjacent swaps and left where the BDD was smallest.
+	 * A direction is abandoned once the size grows past kMaxGrowth times the
+	 * best seen.
+	 */
+	void reorder() {
+		collect();
+
+		// Sifting may pass through larger intermediate orders; only the final size counts against the limit.
+		const size_t limit = node_limit_;
+		node_limit_ = ~size_t(0);
+
+		std::vector<uint32_t> vars(num_vars());
+		for (uint32_t v = 0; v < vars.size(); v++) {
+			vars[v] = v;
+		}
+		std::stable_sort(vars.begin(), vars.end(), [this](uint32_t a, uint32_t b) {
+			return tables_[a].count > tables_[b].count;
+		});
+
+		const size_t bottom = num_vars() ? num_vars() - 1 : 0;
+		for (uint32_t v : vars) {
+			if (tables_[v].count == 0) {
+				break;
+			}
+			size_t best = size(), best_level = var2level_[v];
+
+			while (var2level_[v] < bottom && size() <= kMaxGrowth * best) {
+				swap(var2level_[v]);
+				if (size() < best) {
+					best = size(), best_level = var2level_[v];
+				}
+			}
+			while (var2level_[v] > 0 && size() <= kMaxGrowth * best) {
+				swap(var2level_[v] - 1);
+				if (size() < best) {
+					best = size(), best_level = var2level_[v];
+				}
+			}
+			while (var2level_[v] < best_level) {
+				swap(var2level_[v]);
+			}
+			while (var2level_[v] > best_level) {
+				swap(var2level_[v] - 1);
+			}
+		}
+
+		node_limit_ = limit;
+		clear_cache();
+		reorder_runs_++;
+	}
+
+private:
+	friend class BddRef;
+
+	struct Node {
+		uint32_t var, low, high, ref, next;
+	};
+
+	struct Table {
+		std::vector<uint32_t> buckets;
+		size_t count = 0;
+	};
+
+	struct CacheEntry {
+		uint32_t f, g, h, r;
+	};
+
+	static constexpr uint32_t kTerminal = ~uint32_t(0);
+	static constexpr uint32_t kFree = ~uint32_t(0) - 1;
+	static constexpr uint32_t kNil = ~uint32_t(0);
+	static constexpr size_t kCacheSize = size_t(1) << 18;
+	static constexpr size_t kInitialThreshold = size_t(1) << 16;
+	static constexpr double kMaxGrowth = 1.2;
+
+	BddRef wrap(uint32_t u) {
+		return BddRef(u < 2 ? nullptr : this, u);
+	}
+
+	void ref(uint32_t u) {
+		if (u >= 2) {
+			nodes_[u].ref++;
+		}
+	}
+
+	void deref(uint32_t u) {
+		if (u >= 2) {
+			assert(nodes_[u].ref > 0);
+			nodes_[u].ref--;
+		}
+	}
+
+	/** Like deref(), but frees the node, and whatever it alone kept alive, right away. */
+	void deref_now(uint32_t u) {
+		std::vector<uint32_t> dead;
+		if (u >= 2 && --nodes_[u].ref == 0) {
+			dead.push_back(u);
+		}
+		while (!dead.empty()) {
+			const uint32_t w = dead.back();
+			dead.pop_back();
+			for (uint32_t c : {nodes_[w].low, nodes_[w].high}) {
+				if (c >= 2 && --nodes_[c].ref == 0) {
+					dead.push_back(c);
+				}
+			}
+			release(w);
+		}
+	}
+
+	uint32_t level(uint32_t u) const {
+		return u < 2 ? static_cast<uint32_t>(num_vars()) : var2level_[nodes_[u].var];
+	}
+
+	/** Runs a top-level ite, collecting garbage or reordering first if it is due. */
+	BddRef top(uint32_t f, uint32_t g, uint32_t h) {
+		if (size() > threshold_) {
+			collect();
+			if (auto_reorder_ && size() > reorder_threshold_) {
+				reorder();
+				reorder_threshold_ = std::max(kInitialThreshold, 2 * size());
+			}
+			threshold_ = std::max(kInitialThreshold, 2 * size());
+		}
+		try {
+			return wrap(ite_rec(f, g, h));
+		} catch (const BddNodeLimit&) {
+			// Operands are referenced by the caller, so everything unreferenced is garbage; retry once after freeing it.
+			collect();
+			return wrap(ite_rec(f, g, h));
+		}
+	}
+
+	uint32_t ite_rec(uint32_t f, uint32_t g, uint32_t h) {
+		if (f == 1) {
+			return g;
+		}
+		if (f == 0) {
+			return h;
+		}
+		if (g == h) {
+			return g;
+		}
+		if (g == 1 && h == 0) {
+			return f;
+		}
+		if (g == f) {
+			g = 1;
+		}
+		if (h == f) {
+			h = 0;
+		}
+
+		CacheEntry& e = cache_[hash(f, g, h) & (kCacheSize - 1)];
+		if (e.f == f && e.g == g && e.h == h && e.r != kNil) {
+			return e.r;
+		}
+
+		const uint32_t top_level = std::min({level(f), level(g), level(h)});
+		const uint32_t var = level2var_[top_level];
+		uint32_t f0, f1, g0, g1, h0, h1;
+		cofactors(f, top_level, f0, f1);
+		cofactors(g, top_level, g0, g1);
+		cofactors(h, top_level, h0, h1);
+
+		const uint32_t t = ite_rec(f1, g1, h1);
+		const uint32_t el = ite_rec(f0, g0, h0);
+		const uint32_t r = mk(var, el, t);
+
+		CacheEntry& slot = cache_[hash(f, g, h) & (kCacheSize - 1)];
+		slot = {f, g, h, r};
+		return r;
+	}
+
+	void cofactors(uint32_t u, uint32_t at, uint32_t& u0, uint32_t& u1) const {
+		if (level(u) == at) {
+			u0 = nodes_[u].low;
+			u1 = nodes_[u].high;
+		} else {
+			u0 = u1 = u;
+		}
+	}
+
+	/** The node (var, low, high), reduced and hash-consed. A new node references its children. */
+	uint32_t mk(uint32_t var, uint32_t low, uint32_t high) {
+		if (low == high) {
+			return low;
+		}
+
+		Table& t = tables_[var];
+		if (!t.buckets.empty()) {
+			for (uint32_t u = t.buckets[hash(low, high) & (t.buckets.size() - 1)]; u != kNil; u = nodes_[u].next) {
+				if (nodes_[u].low == low && nodes_[u].high == high) {
+					return u;
+				}
+			}
+		}
+
+		if (size() >= node_limit_) {
+			throw BddNodeLimit(node_limit_);
+		}
+
+		uint32_t u;
+		if (free_ != kNil) {
+			u = free_;
+			free_ = nodes_[u].next;
+			free_count_--;
+			nodes_[u] = {var, low, high, 0, kNil};
+		} else {
+			u = static_cast<uint32_t>(nodes_.size());
+			nodes_.push_back({var, low, high, 0, kNil});
+		}
+		ref(low);
+		ref(high);
+		insert(u);
+		return u;
+	}
+
+	void insert(uint32_t u) {
+		Table& t = tables_[nodes_[u].var];
+		if (2 * (t.count + 1) > t.buckets.size()) {
+			rehash(t, std::max<size_t>(16, 2 * t.buckets.size()));
+		}
+		uint32_t& head = t.buckets[hash(nodes_[u].low, nodes_[u].high) & (t.buckets.size() - 1)];
+		nodes_[u].next = head;
+		head = u;
+		t.count++;
+	}
+
+	void unlink(uint32_t u) {
+		Table& t = tables_[nodes_[u].var];
+		uint32_t* p = &t.buckets[hash(nodes_[u].low, nodes_[u].high) & (t.buckets.size() - 1)];
+		while (*p != u) {
+			p = &nodes_[*p].next;
+		}
+		*p = nodes_[u].next;
+		t.count--;
+	}
+
+	void rehash(Table& t, size_t buckets) {
+		std::vector<uint32_t> old(buckets, kNil);
+		old.swap(t.buckets);
+		for (uint32_t head : old) {
+			for (uint32_t u = head; u != kNil;) {
+				const uint32_t next = nodes_[u].next;
+				uint32_t& slot = t.buckets[hash(nodes_[u].low, nodes_[u].high) & (buckets - 1)];
+				nodes_[u].next = slot;
+				slot = u;
+				u = next;
+			}
+		}
+	}
+
+	void release(uint32_t u) {
+		unlink(u);
+		nodes_[u] = {kFree, 0, 0, 0, free_};
+		free_ = u;
+		free_count_++;
+	}
+
+	/**
+	 * Exchanges the variables at levels i and i + 1 in place. Nodes keep their
+	 * index and their function, so outstanding references stay valid.
+	 */
+	void swap(size_t i) {
+		const uint32_t x = level2var_[i], y = level2var_[i + 1];
+
+		std::vector<uint32_t> moved;
+		moved.reserve(tables_[x].count);
+		for (uint32_t head : tables_[x].buckets) {
+			for (uint32_t u = head; u != kNil; u = nodes_[u].next) {
+				moved.push_back(u);
+			}
+		}
+		tables_[x].buckets.assign(tables_[x].buckets.size(), kNil);
+		tables_[x].count = 0;
+
+		std::swap(level2var_[i], level2var_[i + 1]);
+		var2level_[x] = static_cast<uint32_t>(i + 1);
+		var2level_[y] = static_cast<uint32_t>(i);
+
+		// Nodes not depending on y just move down with x; put them back before building new x nodes.
+		std::vector<uint32_t> rebuilt;
+		for (uint32_t u : moved) {
+			if (var_of(nodes_[u].low) == y || var_of(nodes_[u].high) == y) {
+				rebuilt.push_back(u);
+			} else {
+				insert(u);
+			}
+		}
+
+		for (uint32_t u : rebuilt) {
+			const uint32_t f0 = nodes_[u].low, f1 = nodes_[u].high;
+			const uint32_t f00 = var_of(f0) == y ? nodes_[f0].low : f0;
+			const uint32_t f01 = var_of(f0) == y ? nodes_[f0].high : f0;
+			const uint32_t f10 = var_of(f1) == y ? nodes_[f1].low : f1;
+			const uint32_t f11 = var_of(f1) == y ? nodes_[f1].high : f1;
+
+			const uint32_t low = mk(x, f00, f10);
+			ref(low);
+			const uint32_t high = mk(x, f01, f11);
+			ref(high);
+
+			nodes_[u].var = y;
+			nodes_[u].low = low;
+			nodes_[u].high = high;
+			insert(u);
+
+			deref_now(f0);
+			deref_now(f1);
+		}
+	}
+
+	uint32_t var_of(uint32_t u) const {
+		return u < 2 ? kTerminal : nodes_[u].var;
+	}
+
+	SatCount count_rec(uint32_t u, std::unordered_map<uint32_t, SatCount>& memo) const {
+		if (u < 2) {
+			return SatCount(u);
+		}
+		auto it = memo.find(u);
+		if (it != memo.end()) {
+			return it->second;
+		}
+		const uint32_t l = level(u);
+		SatCount lo = count_rec(nodes_[u].low, memo);
+		SatCount hi = count_rec(nodes_[u].high, memo);
+		lo.shl(level(nodes_[u].low) - l - 1);
+		hi.shl(level(nodes_[u].high) - l - 1);
+		lo += hi;
+		memo.emplace(u, lo);
+		return lo;
+	}
+
+	void clear_cache() {
+		std::fill(cache_.begin(), cache_.end(), CacheEntry{kNil, kNil, kNil, kNil});
+	}
+
+	static size_t hash(uint32_t a, uint32_t b, uint32_t c = 0) {
+		uint64_t h = (uint64_t(a) << 32 | b) * 0x9e3779b97f4a7c15ull;
+		h ^= (h >> 29) + uint64_t(c) * 0xbf58476d1ce4e5b9ull;
+		h ^= h >> 32;
+		return static_cast<size_t>(h);
+	}
+
+private:
+	std::vector<Node> nodes_;
+	std::vector<Table> tables_;
+	std::vector<uint32_t> var2level_, level2var_;
+	std::vector<CacheEntry> cache_;
+	uint32_t free_ = kNil;
+	size_t free_count_ = 0;
+
+	size_t node_limit_ = ~size_t(0);
+	size_t threshold_ = kInitialThreshold;
+	size_t reorder_threshold_ = kInitialThreshold;
+	bool auto_reorder_ = false;
+	size_t gc_runs_ = 0;
+	size_t reorder_runs_ = 0;
+};
+
+inline BddRef::BddRef(Bdd* mgr, uint32_t node) : mgr_(mgr), node_(node) {
+	if (mgr_) {
+		mgr_->ref(node_);
+	}
+}
+
+inline BddRef::~BddRef() {
+	if (mgr_) {
+		mgr_->deref(node_);
+	}
+}
+
+template <>
+inline BddRef Bit<BddRef>::raw_zero() { return BddRef::zero(); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_one() { return BddRef::one(); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_not(const BddRef& a) { return Bdd::current().not_(a); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_and(const BddRef& a, const BddRef& b) { return Bdd::current().and_(a, b); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_or(const BddRef& a, const BddRef& b) { return Bdd::current().or_(a, b); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_xor(const BddRef& a, const BddRef& b) { return Bdd::current().xor_(a, b); }
+
+template <>
+inline BddRef Bit<BddRef>::raw_ite(const BddRef& s, const BddRef& d1, const BddRef& d0) { return Bdd::current().ite(s, d1, d0); }
+
+#endif  // !DESHA256_BDD_H_
@@ -1,8 +1,25 @@
 #ifndef DESHA256_BIT_H_
 #define DESHA256_BIT_H_
 
+#include <cstddef>
 #include <iostream>
 
+/** Carry-propagate adder used by Word additions: ripple-carry is smallest, the parallel-prefix ones have logarithmic depth. */
+enum class AdderKind { ripple, kogge_stone, brent_kung };
+
+/** Adder a backend's Words use by default; backends where circuit depth matters specialize it. */
+template <typename T>
+struct AdderTraits {
+	static constexpr AdderKind kind = AdderKind::ripple;
+};
+
+/** Size of one bit in backend units (clauses, nodes, ...), for instrumentation; backends without a per-bit size report 0. */
+template <typename T>
+struct BitMetrics {
+	static constexpr const char* unit = "none";
+	static size_t size(const T&) { return 0; }
+};
+
 template <typename T>
 class Bit {
 public:
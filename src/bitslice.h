@@ -0,0 +1,169 @@
+#ifndef DESHA256_BITSLICE_H_
+#define DESHA256_BITSLICE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "bit.h"
+
+/**
+ * Bit-sliced backend: every Bit<T> carries one lane per independent message,
+ * so a single Sha256<T> pass hashes sizeof(T) * 8 messages at once.
+ * Lane j of a word-sized T lives in bit j of every 64-bit chunk.
+ * bitslice_pack and bitslice_unpack move whole messages and digests in and
+ * out; the "bitslice" mode of main checks them against Sha256<bool> and
+ * times both. Per hash the sliced path is only about level with
+ * Sha256<bool> fed whole bytes, not a multiple of it.
+ *
+ * lanes256_t and lanes512_t exist only when the target has AVX or AVX-512
+ * (e.g. -march=native): without them, returning such a vector changes the
+ * ABI (GCC's -Wpsabi) and every operation is split into 16-byte halves.
+ */
+#if defined(__GNUC__)
+using lanes128_t = uint64_t __attribute__((vector_size(16)));
+#if defined(__AVX__)
+using lanes256_t = uint64_t __attribute__((vector_size(32)));
+#endif
+#if defined(__AVX512F__)
+using lanes512_t = uint64_t __attribute__((vector_size(64)));
+#endif
+#endif
+
+template <>
+inline uint64_t Bit<uint64_t>::raw_zero() { return 0; }
+template <>
+inline uint64_t Bit<uint64_t>::raw_one() { return ~uint64_t(0); }
+template <>
+inline uint64_t Bit<uint64_t>::raw_not(const uint64_t& a) { return ~a; }
+
+#if defined(__GNUC__)
+template <>
+inline lanes128_t Bit<lanes128_t>::raw_zero() { return lanes128_t{}; }
+template <>
+inline lanes128_t Bit<lanes128_t>::raw_one() { return ~lanes128_t{}; }
+template <>
+inline lanes128_t Bit<lanes128_t>::raw_not(const lanes128_t& a) { return ~a; }
+
+#if defined(__AVX__)
+template <>
+inline lanes256_t Bit<lanes256_t>::raw_zero() { return lanes256_t{}; }
+template <>
+inline lanes256_t Bit<lanes256_t>::raw_one() { return ~lanes256_t{}; }
+template <>
+inline lanes256_t Bit<lanes256_t>::raw_not(const lanes256_t& a) { return ~a; }
+#endif
+
+#if defined(__AVX512F__)
+template <>
+inline lanes512_t Bit<lanes512_t>::raw_zero() { return lanes512_t{}; }
+template <>
+inline lanes512_t Bit<lanes512_t>::raw_one() { return ~lanes512_t{}; }
+template <>
+inline lanes512_t Bit<lanes512_t>::raw_not(const lanes512_t& a) { return ~a; }
+#endif
+#endif
+
+template <typename T>
+struct BitsliceTraits {
+	static_assert(sizeof(T) % sizeof(uint64_t) == 0, "lane type must be a whole number of 64-bit words");
+
+	static constexpr size_t words = sizeof(T) / sizeof(uint64_t);
+	static constexpr size_t lanes = words * 64;
+
+	static uint64_t get(const T& x, size_t w) {
+		uint64_t r;
+		std::memcpy(&r, reinterpret_cast<const char*>(&x) + w * sizeof(uint64_t), sizeof(uint64_t));
+		return r;
+	}
+
+	static void set(T& x, size_t w, uint64_t v) {
+		std::memcpy(reinterpret_cast<char*>(&x) + w * sizeof(uint64_t), &v, sizeof(uint64_t));
+	}
+};
+
+namespace bitslice_detail {
+
+/** In-place transpose of a 64x64 bit matrix, column c being bit 63 - c of each row. */
+inline void transpose64(uint64_t a[64]) {
+	uint64_t m = 0x00000000ffffffffull;
+	for (size_t j = 32; j != 0; j >>= 1, m ^= m << j) {
+		for (size_t k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			uint64_t t = (a[k] ^ (a[k | j] >> j)) & m;
+			a[k] ^= t;
+			a[k | j] ^= t << j;
+		}
+	}
+}
+
+inline uint64_t load_be64(const uint8_t* p, size_t n) {
+	uint64_t r = 0;
+	for (size_t i = 0; i < 8; i++) {
+		r = (r << 8) | (i < n ? p[i] : 0);
+	}
+	return r;
+}
+
+inline void store_be64(uint8_t* p, size_t n, uint64_t x) {
+	for (size_t i = 0; i < 8 && i < n; i++) {
+		p[i] = static_cast<uint8_t>(x >> (56 - 8 * i));
+	}
+}
+
+}  // namespace bitslice_detail
+
+/**
+ * Transposes `count` messages of `len` bytes each into len * 8 sliced bits,
+ * most significant bit of the first byte first, ready for Sha256<T>::Write.
+ * Lanes past `count` are zero.
+ */
+template <typename T>
+void bitslice_pack(const uint8_t* const* messages, size_t count, size_t len, Bit<T>* out) {
+	using traits = BitsliceTraits<T>;
+	const size_t nbits = len * 8;
+	uint64_t m[64];
+
+	std::fill_n(out, nbits, Bit<T>::zero());
+	count = std::min(count, traits::lanes);
+
+	for (size_t c = 0; c < nbits; c += 64) {
+		const size_t bytes = std::min<size_t>(8, len - c / 8);
+		for (size_t w = 0; w * 64 < count; w++) {
+			for (size_t j = 0; j < 64; j++) {
+				const size_t lane = w * 64 + j;
+				m[63 - j] = lane < count ? bitslice_detail::load_be64(messages[lane] + c / 8, bytes) : 0;
+			}
+			bitslice_detail::transpose64(m);
+			for (size_t k = 0; k < 64 && c + k < nbits; k++) {
+				T v = out[c + k].value();
+				traits::set(v, w, m[k]);
+				out[c + k] = v;
+			}
+		}
+	}
+}
+
+/** Inverse of bitslice_pack: writes nbits / 8 bytes of each of the first `count` lanes. */
+template <typename T>
+void bitslice_unpack(const Bit<T>* bits, size_t nbits, uint8_t* const* out, size_t count) {
+	using traits = BitsliceTraits<T>;
+	const size_t len = nbits / 8;
+	uint64_t m[64];
+
+	count = std::min(count, traits::lanes);
+
+	for (size_t c = 0; c < nbits; c += 64) {
+		const size_t bytes = std::min<size_t>(8, len - c / 8);
+		for (size_t w = 0; w * 64 < count; w++) {
+			for (size_t k = 0; k < 64; k++) {
+				m[k] = c + k < nbits ? traits::get(bits[c + k].value(), w) : 0;
+			}
+			bitslice_detail::transpose64(m);
+			for (size_t j = 0; j < 64 && w * 64 + j < count; j++) {
+				bitslice_detail::store_be64(out[w * 64 + j] + c / 8, bytes, m[63 - j]);
+			}
+		}
+	}
+}
+
+#endif  // !DESHA256_BITSLICE_H_
@@ -59,4 +59,10 @@ bx_t Bit<bx_t>::raw_one() {
 	return one_;
 }
 
+template <>
+struct BitMetrics<bx_t> {
+	static constexpr const char* unit = "nodes";
+	static size_t size(const bx_t& x) { return x->size(); }
+};
+
 #endif  // !DESHA256_BOOLEXPR_UTIL_H_
@@ -0,0 +1,284 @@
+#ifndef DESHA256_CHECKPOINT_H_
+#define DESHA256_CHECKPOINT_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mapped_file.h"
+#include "normal_form.h"
+
+/**
+ * Binary checkpoints of NormalForm values, e.g. the state of a long symbolic
+ * Sha256 run after every round. All clauses live in three bulk arrays, so a
+ * file is read through a memory map without any parsing:
+ *
+ *   CheckpointHeader
+ *   uint64_t sides[2 * values + 1]   value k's CNF is clauses [sides[2k], sides[2k+1]),
+ *                                    its DNF [sides[2k+1], sides[2k+2])
+ *   uint64_t clauses[clauses + 1]    clause c is literals [clauses[c], clauses[c+1])
+ *   uint32_t literals[literals]      each clause's literals in increasing order,
+ *                                    numbered as in Clause::for_each_literal()
+ *   uint8_t exact[values]            bit 0: value k's CNF is exact, bit 1: its DNF
+ *
+ * Numbers are in host byte order, and each array is aligned to the size of
+ * its elements (literals and exact may start off an 8-byte boundary). The
+ * header carries three free fields for the caller: run, to identify the
+ * parameters a checkpoint belongs to, and tag and round, to say where the
+ * run was. Opening a file checks every offset and literal against the
+ * header, so a corrupt file is rejected rather than read out of bounds.
+ */
+struct CheckpointHeader {
+	static constexpr char kMagic[8] = {'D', 'S', 'H', 'A', 'C', 'K', 'P', 'T'};
+	static constexpr uint32_t kVersion = 3;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t variables;
+	uint64_t run, tag, round;
+	uint64_t values, clauses, literals;
+};
+
+/** Collects values with add() and writes them out in one go. */
+template <size_t N, typename ClauseT = Clause<N>>
+class CheckpointWriter {
+public:
+	using normal_form_t = NormalForm<N, ClauseT>;
+
+	CheckpointWriter() : sides_(1, 0), clauses_(1, 0) {}
+
+	void add(const normal_form_t& x) {
+		add_side(x.cnf());
+		add_side(x.dnf());
+		exact_.push_back((x.cnf_exact() ? 1 : 0) | (x.dnf_exact() ? 2 : 0));
+	}
+
+	/** Adds a Sha256<normal_form_t>::RoundState: chain, then v, then w, 32 bits per word. */
+	template <typename RoundState>
+	void add_round_state(const RoundState& r) {
+		for (size_t j = 0; j < 8; j++) {
+			add_word(r.chain(j));
+		}
+		for (size_t j = 0; j < 8; j++) {
+			add_word(r.v[j]);
+		}
+		for (size_t j = 0; j < 16; j++) {
+			add_word(r.w(j));
+		}
+	}
+
+	size_t size() const { return sides_.size() / 2; }
+
+	/**
+	 * Writes the file next to path and renames it into place once it is on
+	 * disk, so a crash mid-write leaves the previous checkpoint intact.
+	 */
+	bool write(const std::string& path, uint64_t tag, uint64_t round, uint64_t run = 0) const {
+		CheckpointHeader h;
+		std::memcpy(h.magic, CheckpointHeader::kMagic, sizeof(h.magic));
+		h.version = CheckpointHeader::kVersion;
+		h.variables = static_cast<uint32_t>(N);
+		h.run = run;
+		h.tag = tag;
+		h.round = round;
+		h.values = size();
+		h.clauses = clauses_.size() - 1;
+		h.literals = literals_.size();
+
+		const std::string tmp = path + "." + std::to_string(::getpid()) + ".tmp";
+		std::FILE* f = std::fopen(tmp.c_str(), "wb");
+		if (!f) {
+			return false;
+		}
+		bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+		ok = ok && std::fwrite(sides_.data(), sizeof(uint64_t), sides_.size(), f) == sides_.size();
+		ok = ok && std::fwrite(clauses_.data(), sizeof(uint64_t), clauses_.size(), f) == clauses_.size();
+		ok = ok && std::fwrite(literals_.data(), sizeof(uint32_t), literals_.size(), f) == literals_.size();
+		ok = ok && std::fwrite(exact_.data(), sizeof(uint8_t), exact_.size(), f) == exact_.size();
+		ok = std::fflush(f) == 0 && ok;
+		ok = ::fsync(::fileno(f)) == 0 && ok;
+		ok = std::fclose(f) == 0 && ok;
+		if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+			std::remove(tmp.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	void add_side(const spill_vector<ClauseT>& side) {
+		for (const ClauseT& c : side) {
+			const size_t first = literals_.size();
+			c.for_each_literal([this](size_t lit) {
+				literals_.push_back(static_cast<uint32_t>(lit));
+			});
+			std::sort(literals_.begin() + first, literals_.end());
+			clauses_.push_back(literals_.size());
+		}
+		sides_.push_back(clauses_.size() - 1);
+	}
+
+	template <typename Word>
+	void add_word(const Word& x) {
+		for (size_t i = 0; i < 32; i++) {
+			add(x[i].value());
+		}
+	}
+
+private:
+	std::vector<uint64_t> sides_;
+	std::vector<uint64_t> clauses_;
+	std::vector<uint32_t> literals_;
+	std::vector<uint8_t> exact_;
+};
+
+/** A checkpoint file, mapped read-only; values are rebuilt on request. */
+class Checkpoint {
+public:
+	explicit Checkpoint(const std::string& path) : file_(path) {
+		if (!file_.good()) {
+			error_ = "cannot read " + path;
+			return;
+		}
+		if (file_.size() < sizeof(CheckpointHeader)) {
+			error_ = path + " is too short";
+			return;
+		}
+		std::memcpy(&header_, file_.data(), sizeof(header_));
+		if (std::memcmp(header_.magic, CheckpointHeader::kMagic, sizeof(header_.magic)) != 0) {
+			error_ = path + " is not a checkpoint";
+			return;
+		}
+		if (header_.version != CheckpointHeader::kVersion) {
+			error_ = path + " has version " + std::to_string(header_.version);
+			return;
+		}
+
+		// Every element takes at least a byte, so this also keeps the sum below from overflowing.
+		if (header_.values > file_.size() || header_.clauses > file_.size() || header_.literals > file_.size()) {
+			error_ = path + " is truncated";
+			return;
+		}
+		const uint64_t expected = sizeof(CheckpointHeader) + sizeof(uint64_t) * (2 * header_.values + 1) +
+								  sizeof(uint64_t) * (header_.clauses + 1) + sizeof(uint32_t) * header_.literals +
+								  sizeof(uint8_t) * header_.values;
+		if (file_.size() != expected) {
+			error_ = path + " is truncated";
+			return;
+		}
+		sides_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(CheckpointHeader));
+		clauses_ = sides_ + 2 * header_.values + 1;
+		literals_ = reinterpret_cast<const uint32_t*>(clauses_ + header_.clauses + 1);
+		exact_ = reinterpret_cast<const uint8_t*>(literals_ + header_.literals);
+		if (!consistent()) {
+			error_ = path + " is corrupt";
+			literals_ = nullptr;
+		}
+	}
+
+	Checkpoint(const Checkpoint&) = delete;
+	Checkpoint& operator=(const Checkpoint&) = delete;
+
+	bool good() const { return literals_ != nullptr; }
+	const std::string& error() const { return error_; }
+
+	uint64_t run() const { return header_.run; }
+	uint64_t tag() const { return header_.tag; }
+	uint64_t round() const { return header_.round; }
+	size_t size() const { return header_.values; }
+	size_t variables() const { return header_.variables; }
+
+	/** Value k < size(); the file must have been written for the same N. */
+	template <size_t N, typename ClauseT = Clause<N>>
+	NormalForm<N, ClauseT> get(size_t k) const {
+		assert(good() && k < size() && variables() == N);
+		return NormalForm<N, ClauseT>::restore(side<ClauseT>(2 * k), side<ClauseT>(2 * k + 1), exact_[k] & 1, exact_[k] & 2);
+	}
+
+	/** Reads back what CheckpointWriter::add_round_state() wrote, starting at value first. */
+	template <typename RoundState>
+	bool get_round_state(RoundState& r, size_t first = 0) const {
+		using normal_form_t = std::decay_t<decltype(r.v[0][0].value())>;
+		if (!good() || first + 32 * 32 > size() || variables() != normal_form_t::variables) {
+			return false;
+		}
+		size_t k = first;
+		for (size_t j = 0; j < 8; j++) {
+			get_word<normal_form_t>(r.chain(j), k);
+		}
+		for (size_t j = 0; j < 8; j++) {
+			get_word<normal_form_t>(r.v[j], k);
+		}
+		for (size_t j = 0; j < 16; j++) {
+			get_word<normal_form_t>(r.w(j), k);
+		}
+		r.round = round();
+		return true;
+	}
+
+private:
+	/**
+	 * Whether both offset arrays start at 0, never decrease and end at the
+	 * counts in the header, and every clause lists literals of variables
+	 * below variables() in strictly increasing order.
+	 */
+	bool consistent() const {
+		auto monotonic = [](const uint64_t* a, uint64_t n, uint64_t last) {
+			if (a[0] != 0 || a[n] != last) {
+				return false;
+			}
+			for (uint64_t i = 0; i < n; i++) {
+				if (a[i] > a[i + 1]) {
+					return false;
+				}
+			}
+			return true;
+		};
+		if (!monotonic(sides_, 2 * header_.values, header_.clauses) || !monotonic(clauses_, header_.clauses, header_.literals)) {
+			return false;
+		}
+		for (uint64_t c = 0; c < header_.clauses; c++) {
+			for (uint64_t l = clauses_[c]; l < clauses_[c + 1]; l++) {
+				if (literals_[l] >> 1 >= header_.variables || (l > clauses_[c] && literals_[l] <= literals_[l - 1])) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template <typename ClauseT>
+	spill_vector<ClauseT> side(size_t s) const {
+		spill_vector<ClauseT> r;
+		r.reserve(sides_[s + 1] - sides_[s]);
+		for (uint64_t c = sides_[s]; c < sides_[s + 1]; c++) {
+			r.push_back(ClauseT::from_literals(literals_ + clauses_[c], clauses_[c + 1] - clauses_[c]));
+		}
+		return r;
+	}
+
+	template <typename NormalFormT, typename Word>
+	void get_word(Word&& x, size_t& k) const {
+		for (size_t i = 0; i < 32; i++) {
+			x[i] = get<NormalFormT::variables, typename NormalFormT::clause_type>(k++);
+		}
+	}
+
+private:
+	MappedFile file_;
+	CheckpointHeader header_{};
+	const uint64_t* sides_ = nullptr;
+	const uint64_t* clauses_ = nullptr;
+	const uint32_t* literals_ = nullptr;
+	const uint8_t* exact_ = nullptr;
+	std::string error_;
+};
+
+#endif  // !DESHA256_CHECKPOINT_H_
@@ -2,6 +2,7 @@
 #define DESHA256_CLAUSES_H_
 
 #include <bitset>
+#include <cstdint>
 #include <optional>
 
 template <size_t N>
@@ -17,14 +18,68 @@ public:
 		set[i] = true;
 	}
 
+	/** The clause of n literals numbered as in for_each_literal(). */
+	static clause_t from_literals(const uint32_t* lits, size_t n) {
+		clause_t r;
+		for (size_t k = 0; k < n; k++) {
+			(lits[k] & 1 ? r.clear : r.set)[lits[k] >> 1] = true;
+		}
+		return r;
+	}
+
 	bool valid() const {
 		return (set & clear).none();
 	}
 
+	/** Whether some variable occurs positively in one clause and negatively in the other. */
+	bool clashes(const clause_t& x) const {
+		return (set & x.clear).any() || (clear & x.set).any();
+	}
+
 	bool includes(const clause_t& x) const {
 		return (set | x.set) == set && (clear | x.clear) == clear;
 	}
 
+	/** Number of literals. */
+	size_t size() const {
+		return set.count() + clear.count();
+	}
+
+	/** Calls fn(2 * i) for every literal x_i and fn(2 * i + 1) for every ~x_i. */
+	template <typename Fn>
+	void for_each_literal(Fn fn) const {
+#if defined(__GLIBCXX__)
+		for (size_t i = set._Find_first(); i < N; i = set._Find_next(i)) {
+			fn(2 * i);
+		}
+		for (size_t i = clear._Find_first(); i < N; i = clear._Find_next(i)) {
+			fn(2 * i + 1);
+		}
+#else
+		for (size_t i = 0; i < N; i++) {
+			if (set[i]) {
+				fn(2 * i);
+			}
+			if (clear[i]) {
+				fn(2 * i + 1);
+			}
+		}
+#endif
+	}
+
+	/** One bit per literal hash; a.includes(b) implies b's signature is a subset of a's. */
+	uint64_t signature() const {
+		uint64_t sig = 0;
+		for_each_literal([&sig](size_t lit) {
+			sig |= literal_signature(lit);
+		});
+		return sig;
+	}
+
+	static uint64_t literal_signature(size_t lit) {
+		return uint64_t(1) << ((static_cast<uint32_t>(lit) * 0x9e3779b1u) >> 26);
+	}
+
 	bool operator==(const clause_t& other) const {
 		return set == other.set && clear == other.clear;
 	}
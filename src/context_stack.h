@@ -0,0 +1,47 @@
+#ifndef DESHA256_CONTEXT_STACK_H_
+#define DESHA256_CONTEXT_STACK_H_
+
+/**
+ * The live instances of a context class T, for backends whose Bit<>
+ * operations build into "the current" graph or encoder. T derives from
+ * ContextStack<T>: constructing an instance makes it innermost(), and
+ * destroying one unlinks it wherever it sits, so contexts may be destroyed
+ * in any order and innermost() never dangles.
+ */
+template <typename T>
+class ContextStack {
+protected:
+	ContextStack() : previous_(top_) {
+		if (top_) {
+			top_->next_ = this;
+		}
+		top_ = this;
+	}
+
+	ContextStack(const ContextStack&) = delete;
+	ContextStack& operator=(const ContextStack&) = delete;
+
+	~ContextStack() {
+		if (next_) {
+			next_->previous_ = previous_;
+		} else {
+			top_ = previous_;
+		}
+		if (previous_) {
+			previous_->next_ = next_;
+		}
+	}
+
+	/** The most recently constructed live instance, or nullptr. */
+	static T* innermost() {
+		return static_cast<T*>(top_);
+	}
+
+private:
+	inline static ContextStack* top_ = nullptr;
+
+	ContextStack* previous_;
+	ContextStack* next_ = nullptr;
+};
+
+#endif  // !DESHA256_CONTEXT_STACK_H_
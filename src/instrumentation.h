@@ -0,0 +1,114 @@
+#ifndef DESHA256_INSTRUMENTATION_H_
+#define DESHA256_INSTRUMENTATION_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "bit.h"
+#include "context_stack.h"
+#include "round_hook.h"
+
+/** Peak resident set size of this process in KiB, or 0 if unknown. */
+inline size_t peak_rss_kb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss) / 1024;  // bytes on macOS
+#else
+	return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+/**
+ * Writes one JSON object per round: block and round index, wall time since
+ * construction and since the previous round, peak resident memory, and for
+ * every working word and w the total and largest BitMetrics size of its
+ * bits. Lines are flushed as they are written, so the log can be followed
+ * while a run is going. Rounds go to the innermost live instance; with none,
+ * the hook costs a branch.
+ */
+class JsonRoundLog : public ContextStack<JsonRoundLog> {
+public:
+	explicit JsonRoundLog(std::ostream& out) : out_(out), start_(clock::now()), last_(start_) {}
+
+	JsonRoundLog(const JsonRoundLog&) = delete;
+	JsonRoundLog& operator=(const JsonRoundLog&) = delete;
+
+	template <typename Word>
+	static void round(size_t i, const std::array<const Word*, 8>& state, const Word& w) {
+		if (JsonRoundLog* log = innermost()) {
+			log->record(i, state, w);
+		}
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	template <typename Word>
+	void record(size_t i, const std::array<const Word*, 8>& state, const Word& w) {
+		if (i == 0) {
+			blocks_++;
+		}
+
+		const clock::time_point now = clock::now();
+
+		out_ << "{\"block\":" << blocks_ - 1 << ",\"round\":" << i
+			 << ",\"elapsed_s\":" << std::chrono::duration<double>(now - start_).count()
+			 << ",\"round_s\":" << std::chrono::duration<double>(now - last_).count()
+			 << ",\"peak_rss_kb\":" << peak_rss_kb();
+
+		using T = typename std::decay_t<decltype(w[0].value())>;
+		out_ << ",\"unit\":\"" << BitMetrics<T>::unit << '"';
+		for (size_t r = 0; r < 8; r++) {
+			write_word(std::string(1, static_cast<char>('a' + r)), *state[r]);
+		}
+		write_word("w", w);
+		out_ << '}' << std::endl;
+
+		last_ = now;
+	}
+
+	template <typename Word>
+	void write_word(const std::string& name, const Word& x) {
+		using T = typename std::decay_t<decltype(x[0].value())>;
+		size_t total = 0, max = 0;
+		for (size_t j = 0; j < x.size(); j++) {
+			const size_t n = BitMetrics<T>::size(x[j].value());
+			total += n;
+			max = std::max(max, n);
+		}
+		out_ << ",\"" << name << "\":{\"total\":" << total << ",\"max\":" << max << '}';
+	}
+
+private:
+	std::ostream& out_;
+	clock::time_point start_, last_;
+	size_t blocks_ = 0;
+};
+
+#endif  // !DESHA256_INSTRUMENTATION_H_
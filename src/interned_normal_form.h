@@ -0,0 +1,210 @@
+#ifndef DESHA256_INTERNED_NORMAL_FORM_H_
+#define DESHA256_INTERNED_NORMAL_FORM_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "normal_form.h"
+
+/**
+ * Hash-consed NormalForm: a handle to one shared, immutable value, so
+ * copies cost a reference count and equal values are stored once. Values
+ * are canonicalized (NormalForm::canonicalize()) and looked up in a table
+ * before they are kept. Gates go through a direct-mapped cache keyed on the
+ * operation and the operands' ids, so recomputing a gate on the same
+ * operands, as Sigma0/Sigma1 and the schedule do, is a lookup.
+ *
+ * Neither the table nor the cache keeps a value alive: both hold weak
+ * references, and a value disappears once its last handle does. Ids are
+ * never reused, so a cache entry for a dead operand can never match again.
+ * Cache entries also record NormalForm::budget(), so a gate is recomputed
+ * after the budget changes. Like the other backends, this is not
+ * thread-safe.
+ *
+ * Results are the same functions as plain NormalForm's, but not always the
+ * same clause sets: x & x, x | x and x ^ x are answered without a product,
+ * and under a budget bound() sees the operands in canonical order, so among
+ * equally short clauses it may keep different ones.
+ */
+template <size_t N, typename ClauseT = Clause<N>>
+class InternedNormalForm {
+private:
+	using interned_t = InternedNormalForm<N, ClauseT>;
+	using normal_form_t = NormalForm<N, ClauseT>;
+	using clause_set_t = typename normal_form_t::clause_set_type;
+
+	struct Node {
+		normal_form_t value;
+		uint64_t id;
+	};
+	using node_ptr = std::shared_ptr<const Node>;
+
+	enum class Op : uint8_t { not_, and_, or_, xor_ };
+
+public:
+	InternedNormalForm() : InternedNormalForm(normal_form_t()) {}
+	InternedNormalForm(size_t i) : InternedNormalForm(normal_form_t(i)) {}
+	InternedNormalForm(bool b) : InternedNormalForm(normal_form_t(b)) {}
+	InternedNormalForm(normal_form_t value) : node_(intern(std::move(value))) {}
+
+	interned_t operator~() const {
+		return apply(Op::not_, *this, *this, [](const normal_form_t& a, const normal_form_t&) { return ~a; });
+	}
+
+	/** Same as ~, for the generic Bit<T>::raw_not(). */
+	interned_t operator!() const {
+		return ~*this;
+	}
+
+	interned_t operator&(const interned_t& other) const {
+		if (node_ == other.node_) {
+			return *this;
+		}
+		return apply(Op::and_, *this, other, [](const normal_form_t& a, const normal_form_t& b) { return a & b; });
+	}
+
+	interned_t operator|(const interned_t& other) const {
+		if (node_ == other.node_) {
+			return *this;
+		}
+		return apply(Op::or_, *this, other, [](const normal_form_t& a, const normal_form_t& b) { return a | b; });
+	}
+
+	interned_t operator^(const interned_t& other) const {
+		if (node_ == other.node_) {
+			return interned_t(false);
+		}
+		return apply(Op::xor_, *this, other, [](const normal_form_t& a, const normal_form_t& b) { return a ^ b; });
+	}
+
+	const normal_form_t& value() const { return node_->value; }
+	const clause_set_t& cnf() const { return node_->value.cnf(); }
+	const clause_set_t& dnf() const { return node_->value.dnf(); }
+
+	/** Same value; handles to equal values are always the same node. */
+	bool operator==(const interned_t& other) const { return node_ == other.node_; }
+	bool operator!=(const interned_t& other) const { return node_ != other.node_; }
+
+	/** Gates answered from the cache, and gates computed. */
+	static size_t hits() { return hits_; }
+	static size_t misses() { return misses_; }
+	/** Computed values that turned out to exist already. */
+	static size_t shared() { return shared_; }
+	/** Live entries of the table. */
+	static size_t size() { return table().size(); }
+
+	static void reset_counters() {
+		hits_ = 0;
+		misses_ = 0;
+		shared_ = 0;
+	}
+
+private:
+	explicit InternedNormalForm(node_ptr node) : node_(std::move(node)) {}
+
+	struct CacheEntry {
+		Op op;
+		uint64_t a, b;
+		size_t budget;
+		std::weak_ptr<const Node> result;
+	};
+
+	static std::unordered_multimap<size_t, std::weak_ptr<const Node>>& table() {
+		static std::unordered_multimap<size_t, std::weak_ptr<const Node>> t;
+		return t;
+	}
+
+	static std::vector<CacheEntry>& cache() {
+		static std::vector<CacheEntry> c(kCacheSize);
+		return c;
+	}
+
+	/** The node for value: an existing equal one, or a new one. */
+	static node_ptr intern(normal_form_t value) {
+		value.canonicalize();
+		const size_t h = value.hash();
+
+		auto& t = table();
+		auto [it, end] = t.equal_range(h);
+		while (it != end) {
+			if (node_ptr n = it->second.lock()) {
+				if (n->value == value) {
+					shared_++;
+					return n;
+				}
+				++it;
+			} else {
+				it = t.erase(it);
+			}
+		}
+
+		node_ptr n = std::make_shared<const Node>(Node{std::move(value), next_id_++});
+		t.emplace(h, n);
+		if (t.size() >= sweep_at_) {
+			sweep();
+		}
+		return n;
+	}
+
+	/** Drops the entries of dead values, and sets the next sweep at twice what survives. */
+	static void sweep() {
+		auto& t = table();
+		for (auto it = t.begin(); it != t.end();) {
+			it = it->second.expired() ? t.erase(it) : std::next(it);
+		}
+		sweep_at_ = std::max(kMinSweep, 2 * t.size());
+	}
+
+	template <typename Fn>
+	static interned_t apply(Op op, const interned_t& x, const interned_t& y, Fn fn) {
+		uint64_t a = x.node_->id, b = y.node_->id;
+		if (op != Op::not_ && b < a) {
+			std::swap(a, b);  // every binary op is commutative
+		}
+
+		const size_t budget = normal_form_t::budget();
+		CacheEntry& e = cache()[slot(op, a, b)];
+		if (e.op == op && e.a == a && e.b == b && e.budget == budget) {
+			if (node_ptr r = e.result.lock()) {
+				hits_++;
+				return interned_t(std::move(r));
+			}
+		}
+
+		misses_++;
+		node_ptr r = intern(fn(x.node_->value, y.node_->value));
+		e = {op, a, b, budget, r};
+		return interned_t(std::move(r));
+	}
+
+	static size_t slot(Op op, uint64_t a, uint64_t b) {
+		uint64_t h = (a * 0x9e3779b97f4a7c15ull) ^ (b + static_cast<uint64_t>(op)) * 0xff51afd7ed558ccdull;
+		h ^= h >> 29;
+		return static_cast<size_t>(h) & (kCacheSize - 1);
+	}
+
+private:
+	static constexpr size_t kCacheSize = size_t(1) << 16;
+	static constexpr size_t kMinSweep = size_t(1) << 12;
+
+	inline static uint64_t next_id_ = 1;
+	inline static size_t sweep_at_ = kMinSweep;
+	inline static size_t hits_ = 0;
+	inline static size_t misses_ = 0;
+	inline static size_t shared_ = 0;
+
+	node_ptr node_;
+};
+
+template <size_t N, typename ClauseT>
+struct BitMetrics<InternedNormalForm<N, ClauseT>> {
+	static constexpr const char* unit = "clauses";
+	static size_t size(const InternedNormalForm<N, ClauseT>& x) { return BitMetrics<NormalForm<N, ClauseT>>::size(x.value()); }
+};
+
+#endif  // !DESHA256_INTERNED_NORMAL_FORM_H_
@@ -0,0 +1,334 @@
+#ifndef DESHA256_KERNEL_H_
+#define DESHA256_KERNEL_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "netlist.h"
+
+/**
+ * A CompiledNetlist turned into straight-line C, built into a shared object
+ * by the system compiler and loaded with dlopen. Inputs that were constant
+ * when the netlist was recorded are already folded away, and only the cone
+ * of the requested outputs is emitted, so every header template gets a
+ * kernel without any constant work in it.
+ *
+ * Objects are cached on disk under the hash of their source, so a circuit is
+ * compiled once per cache directory: $DESHA256_KERNEL_CACHE if set, else
+ * desha256-kernels under $XDG_CACHE_HOME or ~/.cache. Loading a cached object
+ * runs its code, so the directory is created with mode 0700, and nothing is
+ * loaded from a directory or file that belongs to another user or that
+ * others can write to. A cached object is only loaded if the source saved
+ * next to it (base.c, its first line the compiler command) is exactly the one
+ * this circuit needs; otherwise it is rebuilt. $CC picks the compiler
+ * (default cc); it is split on whitespace and run without a shell.
+ *
+ * The kernel evaluates 64 lanes per call: in[i] holds input i of every
+ * lane, out[k] receives output k.
+ */
+class Kernel {
+public:
+	using fn_t = void (*)(const uint64_t* in, uint64_t* out, uint64_t* scratch);
+
+	explicit Kernel(const CompiledNetlist& program) : Kernel(program, default_cache_dir()) {}
+
+	Kernel(const CompiledNetlist& program, const std::string& cache_dir) : slots_(1 + program.num_inputs() + program.num_gates()) {
+		const std::string code = "// " + join(compiler()) + "\n" + source(program);
+		char name[17];
+		std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fnv1a(code)));
+		const std::string base = cache_dir + "/" + name;
+		path_ = base + ".so";
+
+		if (!make_dirs(cache_dir) || !private_to_user(cache_dir, true)) {
+			error_ = "unsafe kernel cache " + cache_dir + ": not a directory of this user's that only it can write to";
+			return;
+		}
+		if (::access(path_.c_str(), R_OK) != 0 || !built_from(base + ".c", code)) {
+			if (!build(code, base)) {
+				return;
+			}
+			compiled_ = true;
+		}
+		if (!private_to_user(path_, false)) {
+			error_ = "refusing to load " + path_ + ": not a file of this user's that only it can write to";
+			return;
+		}
+
+		handle_ = ::dlopen(path_.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (!handle_) {
+			error_ = ::dlerror();
+			return;
+		}
+		fn_ = reinterpret_cast<fn_t>(::dlsym(handle_, "desha256_kernel"));
+		if (!fn_) {
+			error_ = "desha256_kernel not found in " + path_;
+		}
+	}
+
+	Kernel(const Kernel&) = delete;
+	Kernel& operator=(const Kernel&) = delete;
+
+	bool good() const { return fn_ != nullptr; }
+	const std::string& error() const { return error_; }
+
+	/** Path of the shared object, and whether this instance had to compile it. */
+	const std::string& path() const { return path_; }
+	bool compiled() const { return compiled_; }
+
+	/** One call, 64 lanes; scratch is reused between calls. */
+	void operator()(const uint64_t* in, uint64_t* out, std::vector<uint64_t>& scratch) const {
+		scratch.resize(slots_);
+		fn_(in, out, scratch.data());
+	}
+
+	void operator()(const uint64_t* in, uint64_t* out) const {
+		std::vector<uint64_t> scratch;
+		(*this)(in, out, scratch);
+	}
+
+	/**
+	 * The C source of the kernel. One huge function takes the compiler
+	 * superlinear time, so the gates are cut into functions of kChunk gates
+	 * each. Within a function values are locals; a value read by a later
+	 * function or by an output is also stored to the scratch array v.
+	 */
+	static std::string source(const CompiledNetlist& program) {
+		const size_t inputs = program.num_inputs();
+		const size_t first = 1 + inputs;
+		auto chunk = [first](uint32_t slot) { return (slot - first) / kChunk; };
+
+		// Last chunk reading each slot; outputs count as a chunk of their own.
+		std::vector<size_t> last_use(first + program.num_gates(), 0);
+		program.for_each_gate([&](uint32_t slot, bool, uint32_t a, uint32_t b) {
+			last_use[a >> 1] = std::max(last_use[a >> 1], chunk(slot));
+			last_use[b >> 1] = std::max(last_use[b >> 1], chunk(slot));
+		});
+		const size_t chunks = (program.num_gates() + kChunk - 1) / kChunk;
+		for (size_t k = 0; k < program.num_outputs(); k++) {
+			last_use[program.output(k) >> 1] = chunks;
+		}
+
+		size_t current = 0;
+		auto operand = [&](uint32_t x) {
+			const uint32_t slot = x >> 1;
+			std::string s;
+			if (slot == 0) {
+				s = "(uint64_t)0";
+			} else if (slot < first) {
+				s = "in[" + std::to_string(slot - 1) + "]";
+			} else if (chunk(slot) == current) {
+				s = "t" + std::to_string(slot);
+			} else {
+				s = "v[" + std::to_string(slot) + "]";
+			}
+			return x & 1 ? "~" + s : s;
+		};
+
+		std::ostringstream out;
+		out << "#include <stdint.h>\n";
+		program.for_each_gate([&](uint32_t slot, bool is_xor, uint32_t a, uint32_t b) {
+			current = chunk(slot);
+			if ((slot - first) % kChunk == 0) {
+				if (current) {
+					out << "}\n";
+				}
+				out << "__attribute__((noinline)) static void part" << current << "(const uint64_t* restrict in, uint64_t* restrict v) {\n";
+			}
+			out << "\tconst uint64_t t" << slot << " = " << operand(a) << (is_xor ? " ^ " : " & ") << operand(b) << ";\n";
+			if (last_use[slot] > current) {
+				out << "\tv[" << slot << "] = t" << slot << ";\n";
+			}
+		});
+		if (chunks) {
+			out << "}\n";
+		}
+
+		current = chunks;
+		out << "void desha256_kernel(const uint64_t* restrict in, uint64_t* restrict out, uint64_t* restrict v) {\n";
+		for (size_t c = 0; c < chunks; c++) {
+			out << "\tpart" << c << "(in, v);\n";
+		}
+		for (size_t k = 0; k < program.num_outputs(); k++) {
+			out << "\tout[" << k << "] = " << operand(program.output(k)) << ";\n";
+		}
+		out << "}\n";
+		return out.str();
+	}
+
+	static std::string default_cache_dir() {
+		if (const char* dir = std::getenv("DESHA256_KERNEL_CACHE")) {
+			return dir;
+		}
+		if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg == '/') {
+			return std::string(xdg) + "/desha256-kernels";
+		}
+		const char* home = std::getenv("HOME");
+		if (!home || !*home) {
+			const passwd* pw = ::getpwuid(::geteuid());
+			home = pw ? pw->pw_dir : "";
+		}
+		return std::string(home) + "/.cache/desha256-kernels";
+	}
+
+	~Kernel() {
+		if (handle_) {
+			::dlclose(handle_);
+		}
+	}
+
+private:
+	static constexpr size_t kChunk = 1024;
+
+	/** The compiler command without output and input: $CC split on whitespace, then the flags. */
+	static std::vector<std::string> compiler() {
+		const char* cc = std::getenv("CC");
+		std::istringstream words(cc && *cc ? cc : "cc");
+		std::vector<std::string> argv;
+		for (std::string w; words >> w;) {
+			argv.push_back(w);
+		}
+		for (const char* flag : {"-std=c99", "-O1", "-shared", "-fPIC"}) {
+			argv.emplace_back(flag);
+		}
+		return argv;
+	}
+
+	static std::string join(const std::vector<std::string>& argv) {
+		std::string s;
+		for (const std::string& a : argv) {
+			s += (s.empty() ? "" : " ") + a;
+		}
+		return s;
+	}
+
+	/** Runs argv[0] (looked up in PATH) with argv, no shell involved; true if it exits with 0. */
+	static bool run(const std::vector<std::string>& argv) {
+		std::vector<char*> args;
+		for (const std::string& a : argv) {
+			args.push_back(const_cast<char*>(a.c_str()));
+		}
+		args.push_back(nullptr);
+
+		const pid_t pid = ::fork();
+		if (pid < 0) {
+			return false;
+		}
+		if (pid == 0) {
+			::execvp(args[0], args.data());
+			::_exit(127);
+		}
+		int status;
+		while (::waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR) {
+				return false;
+			}
+		}
+		return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	/** Whether c_path is a private file holding exactly code, i.e. the object next to it was built from this circuit. */
+	static bool built_from(const std::string& c_path, const std::string& code) {
+		if (!private_to_user(c_path, false)) {
+			return false;
+		}
+		std::ifstream f(c_path, std::ios::binary);
+		std::ostringstream saved;
+		saved << f.rdbuf();
+		return f.good() && saved.str() == code;
+	}
+
+	/** Creates path and its missing parents, mode 0700. Existing directories are left as they are. */
+	static bool make_dirs(const std::string& path) {
+		for (size_t i = path.find('/', 1);; i = path.find('/', i + 1)) {
+			const std::string prefix = path.substr(0, i);
+			if (!prefix.empty() && ::mkdir(prefix.c_str(), 0700) != 0 && errno != EEXIST) {
+				return false;
+			}
+			if (i == std::string::npos) {
+				return true;
+			}
+		}
+	}
+
+	/**
+	 * Whether path is a directory (followed if it is a symlink) or a regular
+	 * file (never followed), owned by this user and writable by no one else.
+	 */
+	static bool private_to_user(const std::string& path, bool directory) {
+		struct stat st;
+		if ((directory ? ::stat(path.c_str(), &st) : ::lstat(path.c_str(), &st)) != 0) {
+			return false;
+		}
+		const bool kind = directory ? S_ISDIR(st.st_mode) : S_ISREG(st.st_mode);
+		return kind && st.st_uid == ::geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+	}
+
+	static uint64_t fnv1a(const std::string& s) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (unsigned char c : s) {
+			h = (h ^ c) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	/**
+	 * Compiles code to base.so and leaves it in base.c. Both are written under
+	 * per-process temporary names and renamed into place, the source first, so
+	 * concurrent builders never read or load a partial file.
+	 */
+	bool build(const std::string& code, const std::string& base) {
+		const std::string tmp = base + "." + std::to_string(::getpid()) + ".tmp";
+		const std::string tmp_c = tmp + ".c", tmp_so = tmp + ".so";
+		{
+			std::ofstream f(tmp_c, std::ios::binary | std::ios::trunc);
+			f << code;
+			if (!f.good()) {
+				error_ = "cannot write " + tmp_c;
+				std::remove(tmp_c.c_str());
+				return false;
+			}
+		}
+
+		std::vector<std::string> argv = compiler();
+		argv.insert(argv.end(), {"-o", tmp_so, tmp_c});
+		if (!run(argv)) {
+			error_ = "compiler failed: " + join(argv);
+			std::remove(tmp_c.c_str());
+			std::remove(tmp_so.c_str());
+			return false;
+		}
+		// Whatever the umask, only this user may replace what gets loaded.
+		::chmod(tmp_c.c_str(), 0600);
+		::chmod(tmp_so.c_str(), 0700);
+		if (std::rename(tmp_c.c_str(), (base + ".c").c_str()) != 0 || std::rename(tmp_so.c_str(), path_.c_str()) != 0) {
+			error_ = "cannot rename " + tmp + ".*";
+			std::remove(tmp_c.c_str());
+			std::remove(tmp_so.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	size_t slots_;
+	std::string path_;
+	std::string error_;
+	void* handle_ = nullptr;
+	fn_t fn_ = nullptr;
+	bool compiled_ = false;
+};
+
+#endif  // !DESHA256_KERNEL_H_
@@ -0,0 +1,167 @@
+#ifndef DESHA256_LAZY_NORMAL_FORM_H_
+#define DESHA256_LAZY_NORMAL_FORM_H_
+
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "normal_form.h"
+
+/**
+ * NormalForm whose operators only record the gate. cnf() and dnf() evaluate
+ * the pending DAG on request and materialize just the side of each node that
+ * is needed for the answer. Results are cached in shared nodes only: a node
+ * drops its operands once both of its sides are known, and the intermediate
+ * result of an operand it owns alone is dropped as soon as it has been used.
+ */
+template <size_t N, typename ClauseT = Clause<N>>
+class LazyNormalForm {
+private:
+	using lazy_normal_form_t = LazyNormalForm<N, ClauseT>;
+	using normal_form_t = NormalForm<N, ClauseT>;
+	using clause_t = ClauseT;
+	using clause_set_t = typename normal_form_t::clause_set_type;
+
+	enum class Op : unsigned char { leaf, not_, and_, or_ };
+
+	struct Node;
+	using node_ptr = std::shared_ptr<const Node>;
+
+	struct Node {
+		Op op;
+		mutable node_ptr lhs, rhs;
+		mutable std::optional<clause_set_t> side[2];  // cnf, dnf
+
+		Node(Op op, node_ptr lhs, node_ptr rhs) : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
+
+		/** Releases long operand chains iteratively instead of recursing through destructors. */
+		~Node() {
+			std::vector<node_ptr> pending;
+			pending.push_back(std::move(lhs));
+			pending.push_back(std::move(rhs));
+			while (!pending.empty()) {
+				node_ptr n = std::move(pending.back());
+				pending.pop_back();
+				if (n && n.use_count() == 1) {
+					pending.push_back(std::move(n->lhs));
+					pending.push_back(std::move(n->rhs));
+				}
+			}
+		}
+	};
+
+	static constexpr int kCnf = 0;
+	static constexpr int kDnf = 1;
+
+public:
+	LazyNormalForm() : LazyNormalForm(normal_form_t()) {}
+	LazyNormalForm(size_t i) : LazyNormalForm(normal_form_t(i)) {}
+	LazyNormalForm(bool b) : LazyNormalForm(normal_form_t(b)) {}
+	LazyNormalForm(const normal_form_t& nf) : node_(std::make_shared<Node>(Op::leaf, nullptr, nullptr)) {
+		node_->side[kCnf] = nf.cnf();
+		node_->side[kDnf] = nf.dnf();
+	}
+
+	lazy_normal_form_t operator~() const {
+		return lazy_normal_form_t(Op::not_, node_, nullptr);
+	}
+
+	lazy_normal_form_t operator&(const lazy_normal_form_t& other) const {
+		return lazy_normal_form_t(Op::and_, node_, other.node_);
+	}
+
+	lazy_normal_form_t operator|(const lazy_normal_form_t& other) const {
+		return lazy_normal_form_t(Op::or_, node_, other.node_);
+	}
+
+	lazy_normal_form_t operator^(const lazy_normal_form_t& other) const {
+		return (*this & ~other) | (~*this & other);
+	}
+
+	const clause_set_t& cnf() const {
+		return force(node_, kCnf);
+	}
+
+	const clause_set_t& dnf() const {
+		return force(node_, kDnf);
+	}
+
+	/** Both sides, materialized. */
+	normal_form_t eval() const {
+		return {cnf(), dnf()};
+	}
+
+	~LazyNormalForm() {}
+
+private:
+	LazyNormalForm(Op op, node_ptr lhs, node_ptr rhs) : node_(std::make_shared<Node>(op, std::move(lhs), std::move(rhs))) {}
+
+	/*
+	 * Side s of a node needs:
+	 *   not: side !s of the operand (then flipped);
+	 *   and: cnf = cat of cnfs,     dnf = product of dnfs;
+	 *   or:  cnf = product of cnfs, dnf = cat of dnfs.
+	 * Evaluated with an explicit stack, the DAG being far deeper than the call stack.
+	 */
+	static const clause_set_t& force(const node_ptr& root, int side) {
+		std::vector<std::pair<const Node*, int>> stack;
+		stack.emplace_back(root.get(), side);
+
+		while (!stack.empty()) {
+			const Node* n = stack.back().first;
+			const int s = stack.back().second;
+
+			if (n->side[s]) {
+				stack.pop_back();
+				continue;
+			}
+
+			const int operand_side = n->op == Op::not_ ? 1 - s : s;
+			bool ready = true;
+			for (const Node* c : {n->lhs.get(), n->rhs.get()}) {
+				if (c && !c->side[operand_side]) {
+					stack.emplace_back(c, operand_side);
+					ready = false;
+				}
+			}
+			if (!ready) {
+				continue;
+			}
+
+			switch (n->op) {
+				case Op::not_:
+					n->side[s] = normal_form_t::flip(*n->lhs->side[operand_side]);
+					break;
+				case Op::and_:
+					n->side[s] = s == kCnf ? normal_form_t::cat(*n->lhs->side[s], *n->rhs->side[s]) : normal_form_t::product(*n->lhs->side[s], *n->rhs->side[s]);
+					break;
+				case Op::or_:
+					n->side[s] = s == kCnf ? normal_form_t::product(*n->lhs->side[s], *n->rhs->side[s]) : normal_form_t::cat(*n->lhs->side[s], *n->rhs->side[s]);
+					break;
+				case Op::leaf:
+					break;
+			}
+
+			if (n->side[kCnf] && n->side[kDnf]) {
+				n->lhs.reset();
+				n->rhs.reset();
+			} else {
+				// An operand nobody else holds can only be read again through this node's other side.
+				for (const node_ptr* c : {&n->lhs, &n->rhs}) {
+					if (*c && c->use_count() == 1 && (*c)->op != Op::leaf) {
+						(*c)->side[operand_side].reset();
+					}
+				}
+			}
+			stack.pop_back();
+		}
+
+		return *root->side[side];
+	}
+
+private:
+	std::shared_ptr<Node> node_;
+};
+
+#endif  // !DESHA256_LAZY_NORMAL_FORM_H_
@@ -1,8 +1,30 @@
-﻿#include <iostream>
+﻿#include <bitset>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
 
+#include "aig.h"
+#include "anf.h"
+#include "bdd.h"
+#include "bitslice.h"
 #include "boolexpr_util.h"
+#include "checkpoint.h"
+#include "instrumentation.h"
+#include "interned_normal_form.h"
+#include "kernel.h"
+#include "lazy_normal_form.h"
+#include "mapped_file.h"
+#include "netlist.h"
 #include "normal_form.h"
+#include "partial.h"
 #include "sha256.h"
+#include "solver.h"
+#include "tseitin.h"
 #include "word.h"
 
 template <size_t N>
@@ -24,8 +46,8 @@ std::ostream& operator<<(std::ostream& s, Word<boolexpr::bx_t, N> x) {
 	return s;
 }
 
-template <size_t N>
-std::string clause_to_string(const Clause<N>& set, const std::string& sep) {
+template <size_t N, template <size_t> class ClauseT>
+std::string clause_to_string(const ClauseT<N>& set, const std::string& sep) {
 	std::string s;
 	bool init = false;
 	s += '(';
@@ -48,8 +70,8 @@ std::string clause_to_string(const Clause<N>& set, const std::string& sep) {
 	return s;
 }
 
-template <size_t N>
-std::string cluase_set_to_string(const std::vector<Clause<N>>& set, const std::string& sep1, const std::string& sep2) {
+template <size_t N, template <size_t> class ClauseT>
+std::string cluase_set_to_string(const spill_vector<ClauseT<N>>& set, const std::string& sep1, const std::string& sep2) {
 	std::string s;
 	bool init = false;
 
@@ -66,20 +88,745 @@ std::string cluase_set_to_string(const std::vector<Clause<N>>& set, const std::s
 	return s;
 }
 
-template <size_t N>
-std::ostream& operator<<(std::ostream& s, const NormalForm<N>& nf) {
+template <size_t N, typename ClauseT>
+std::ostream& operator<<(std::ostream& s, const NormalForm<N, ClauseT>& nf) {
 	std::cout << "cnf: " << cluase_set_to_string(nf.cnf(), " | ", " & ") << std::endl
 			  << "dnf: " << cluase_set_to_string(nf.dnf(), " & ", " | ") << std::endl;
 	return s;
 }
 
-int main() {
+template <size_t N, typename ClauseT>
+std::ostream& operator<<(std::ostream& s, const InternedNormalForm<N, ClauseT>& x) {
+	return s << x.value();
+}
+
+/** Per-round JSON lines of a symbolic run, written to $DESHA256_TRACE when it is set. */
+class Trace {
+public:
+	Trace() {
+		if (const char* path = std::getenv("DESHA256_TRACE")) {
+			file_.open(path);
+			log_.emplace(file_);
+		}
+	}
+
+private:
+	std::ofstream file_;
+	std::optional<JsonRoundLog> log_;
+};
+
+int run_aig() {
+	Aig aig;
+
+	std::unique_ptr<Sha256<AigLit>> sha = std::make_unique<Sha256<AigLit>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(aig.input(i));
+	}
+
+	sha->Finalize();
+
+	std::cout << std::endl
+			  << "aig: " << aig.size() << " nodes, " << aig.num_ands() << " ands, " << aig.memory() << " bytes" << std::endl;
+
+	return 0;
+}
+
+template <size_t Rounds>
+void aig_rounds() {
+	Aig aig;
+
+	std::unique_ptr<Sha256<AigLit, Rounds>> sha = std::make_unique<Sha256<AigLit, Rounds>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(aig.input(i));
+	}
+
+	sha->Finalize();
+
+	std::cout << std::endl
+			  << Rounds << " rounds: " << aig.num_ands() << " ands" << std::endl;
+}
+
+/** Textbook compression function cut to the first `rounds` rounds, with the usual renaming of a..h. */
+void reference_compress(uint32_t state[8], const uint32_t block[16], size_t rounds) {
+	static constexpr uint32_t k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+	auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+	uint32_t w[64];
+	for (size_t i = 0; i < 64; i++) {
+		w[i] = i < 16 ? block[i]
+					  : w[i - 16] + (rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3)) + w[i - 7] +
+							(rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10));
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+	for (size_t i = 0; i < rounds; i++) {
+		const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+		const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	const uint32_t v[8] = {a, b, c, d, e, f, g, h};
+	for (size_t j = 0; j < 8; j++) {
+		state[j] += v[j];
+	}
+}
+
+/** Compares Sha256<bool, Rounds>::Compress() with the reference on random blocks; returns the number of mismatches. */
+template <size_t Rounds>
+size_t check_rounds(size_t blocks) {
+	using H = Sha256<bool, Rounds>;
+	std::mt19937 rng(Rounds);
+	size_t mismatches = 0;
+	for (size_t n = 0; n < blocks; n++) {
+		uint32_t expected[8], block[16];
+		typename H::state_t state = H::InitialState();
+		typename H::block_t b;
+		for (size_t j = 0; j < 8; j++) {
+			state(j) = rng();
+			expected[j] = state(j).value();
+		}
+		for (size_t j = 0; j < 16; j++) {
+			block[j] = rng();
+			b(j) = block[j];
+		}
+		reference_compress(expected, block, Rounds);
+		H::Compress(state, b);
+		for (size_t j = 0; j < 8; j++) {
+			if (state(j).value() != expected[j]) {
+				mismatches++;
+				break;
+			}
+		}
+	}
+	std::cout << Rounds << " rounds: " << (blocks - mismatches) << "/" << blocks << " blocks match the reference" << std::endl;
+	return mismatches;
+}
+
+/**
+ * Checks round counts on both sides of a multiple of 8 against the
+ * reference, then prints the AIG size of the 640-input circuit as the round
+ * count grows from 8 to 64.
+ */
+template <size_t... Rounds>
+int run_rounds(std::index_sequence<Rounds...>) {
+	const size_t mismatches = check_rounds<4>(20) + check_rounds<8>(20) + check_rounds<13>(20) + check_rounds<20>(20) + check_rounds<64>(20);
+	if (mismatches) {
+		return 1;
+	}
+	(aig_rounds<8 * (Rounds + 1)>(), ...);
+	return 0;
+}
+
+/**
+ * Slices the 640-bit hash to its first `bits` digest bits: reports what the
+ * cone prunes, the AIG size with and without it, and the concrete speed.
+ */
+int run_cone(size_t bits) {
+	std::bitset<256> mask;
+	for (size_t i = 0; i < bits && i < 256; i++) {
+		mask[i] = true;
+	}
+	const Sha256<bool>::Cone cone = Sha256<bool>::Cone::Plan(mask);
+	std::cout << "cone: " << bits << " bits, pruned " << cone.pruned_updates() << " of 128 state updates, "
+			  << cone.pruned_schedule() << " of 64 schedule words, " << cone.pruned_outputs() << " of 8 output additions" << std::endl;
+
+	for (const Sha256<bool>::Cone* c : {&Sha256<bool>::Cone::Full(), &cone}) {
+		Aig aig;
+		std::unique_ptr<Sha256<AigLit>> sha = std::make_unique<Sha256<AigLit>>();
+		for (size_t i = 0; i < 640; i++) {
+			sha->Write(aig.input(i));
+		}
+		sha->Finalize(*c);
+		std::cout << (c == &cone ? "sliced" : "full") << ": " << aig.num_ands() << " ands";
+
+		std::mt19937_64 rng(1);
+		std::vector<uint8_t> header(80);
+		for (uint8_t& b : header) {
+			b = rng();
+		}
+		const size_t passes = 20000;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < passes; k++) {
+			header[79] = k;
+			Sha256<bool> h;
+			h.Write(header.data(), header.size());
+			h.Finalize(*c);
+		}
+		std::cout << ", " << passes / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " hashes/s" << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * Hashes messages through Sha256<T>, traits::lanes at a time: pack, hash,
+ * unpack, the way a batch caller would. Returns hashes per second, packing
+ * and unpacking included, and counts the lanes whose digest differs from
+ * expected into mismatches.
+ */
+template <typename T>
+double bitslice_speed(const std::vector<std::vector<uint8_t>>& messages, const std::vector<std::vector<uint8_t>>& expected, size_t& mismatches) {
+	using traits = BitsliceTraits<T>;
+	const size_t len = messages[0].size();
+	std::vector<Bit<T>> bits(8 * len);
+	std::vector<std::vector<uint8_t>> digests(traits::lanes, std::vector<uint8_t>(32));
+	std::vector<const uint8_t*> in(traits::lanes);
+	std::vector<uint8_t*> out(traits::lanes);
+	for (size_t j = 0; j < traits::lanes; j++) {
+		out[j] = digests[j].data();
+	}
+	std::unique_ptr<Sha256<T>> sha = std::make_unique<Sha256<T>>();
+
+	size_t wrong = 0;
+	std::chrono::steady_clock::duration elapsed{};
+	for (size_t first = 0; first < messages.size(); first += traits::lanes) {
+		const size_t count = std::min(traits::lanes, messages.size() - first);
+		for (size_t j = 0; j < count; j++) {
+			in[j] = messages[first + j].data();
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		bitslice_pack<T>(in.data(), count, len, bits.data());
+		sha->Reset();
+		sha->Write(bits.data(), bits.size());
+		bitslice_unpack<T>(sha->Finalize().data(), 256, out.data(), count);
+		elapsed += std::chrono::steady_clock::now() - start;
+
+		for (size_t j = 0; j < count; j++) {
+			wrong += digests[j] != expected[first + j];
+		}
+	}
+	mismatches += wrong;
+	return messages.size() / std::chrono::duration<double>(elapsed).count();
+}
+
+/**
+ * Hashes `count` random messages of `len` bytes with Sha256<bool> fed
+ * whole bytes, then again bit-sliced at every lane width the build has,
+ * through bitslice_pack and bitslice_unpack. Every lane's digest is
+ * compared with Sha256<bool>; the last batch is partial unless count is a
+ * multiple of the lane count.
+ */
+int run_bitslice(size_t count, size_t len) {
+	std::mt19937_64 rng(1);
+	std::vector<std::vector<uint8_t>> messages(count, std::vector<uint8_t>(len));
+	for (auto& m : messages) {
+		for (uint8_t& b : m) {
+			b = rng();
+		}
+	}
+
+	std::vector<std::vector<uint8_t>> expected(count, std::vector<uint8_t>(32));
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t k = 0; k < count; k++) {
+		Sha256<bool> h;
+		h.Write(messages[k].data(), len);
+		const auto& digest = h.Finalize();
+		for (size_t i = 0; i < 256; i++) {
+			expected[k][i / 8] |= digest[i].value() << (7 - i % 8);
+		}
+	}
+	const double scalar = count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Sha256<bool>, bytes: " << scalar << " hashes/s" << std::endl;
+
+	size_t mismatches = 0;
+	auto report = [&](const char* name, double speed) {
+		std::cout << name << ": " << speed << " hashes/s, " << speed / scalar << "x Sha256<bool>" << std::endl;
+	};
+	report("64 lanes", bitslice_speed<uint64_t>(messages, expected, mismatches));
+#if defined(__GNUC__)
+	report("128 lanes", bitslice_speed<lanes128_t>(messages, expected, mismatches));
+#if defined(__AVX__)
+	report("256 lanes", bitslice_speed<lanes256_t>(messages, expected, mismatches));
+#endif
+#if defined(__AVX512F__)
+	report("512 lanes", bitslice_speed<lanes512_t>(messages, expected, mismatches));
+#endif
+#endif
+	std::cout << mismatches << " mismatches" << std::endl;
+
+	return mismatches ? 1 : 0;
+}
+
+/**
+ * Evaluates program on batches of random messages, W's lane count at a
+ * time, until about `hashes` messages are done. Returns hashes per second
+ * and checks every lane of the last batch against its own Sha256<bool>
+ * digest, counting wrong bits into mismatches.
+ */
+template <typename W>
+double netlist_speed(const CompiledNetlist& program, size_t hashes, size_t& mismatches) {
+	using traits = BitsliceTraits<W>;
+	std::mt19937_64 rng(1);
+	std::vector<W> in(program.num_inputs()), out(program.num_outputs()), scratch;
+	const size_t passes = std::max<size_t>(1, hashes / traits::lanes);
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t k = 0; k < passes; k++) {
+		for (W& x : in) {
+			for (size_t w = 0; w < traits::words; w++) {
+				traits::set(x, w, rng());
+			}
+		}
+		program.run(in.data(), out.data(), scratch);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (size_t lane = 0; lane < traits::lanes; lane++) {
+		const size_t w = lane / 64, j = lane % 64;
+		Sha256<bool> check;
+		for (size_t i = 0; i < in.size(); i++) {
+			check.Write(Bit<bool>(traits::get(in[i], w) >> j & 1));
+		}
+		const auto& digest = check.Finalize();
+		for (size_t i = 0; i < 256; i++) {
+			mismatches += digest[i].value() != bool(traits::get(out[i], w) >> j & 1);
+		}
+	}
+	return traits::lanes * passes / seconds;
+}
+
+/**
+ * Records the 640-input circuit once as a netlist, then evaluates it on
+ * 64 * `passes` random messages at every lane width the build has, next to
+ * Sha256<bool> fed whole bytes. Every lane of the last batch at each width
+ * is checked against Sha256<bool>.
+ */
+int run_netlist(size_t passes) {
+	Netlist net;
+
+	std::unique_ptr<Sha256<GateRef>> sha = std::make_unique<Sha256<GateRef>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(net.input(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::vector<GateRef> outputs;
+	for (size_t i = 0; i < 256; i++) {
+		outputs.push_back(r[i].value());
+	}
+	const CompiledNetlist program(net, outputs);
+	std::cout << "netlist: " << program.num_gates() << " gates in " << program.num_slots() << " slots" << std::endl;
+
+	const size_t hashes = 64 * passes;
+	size_t mismatches = 0;
+	std::cout << "64 lanes: " << netlist_speed<uint64_t>(program, hashes, mismatches) << " hashes/s" << std::endl;
+#if defined(__GNUC__)
+	std::cout << "128 lanes: " << netlist_speed<lanes128_t>(program, hashes, mismatches) << " hashes/s" << std::endl;
+#if defined(__AVX__)
+	std::cout << "256 lanes: " << netlist_speed<lanes256_t>(program, hashes, mismatches) << " hashes/s" << std::endl;
+#endif
+#if defined(__AVX512F__)
+	std::cout << "512 lanes: " << netlist_speed<lanes512_t>(program, hashes, mismatches) << " hashes/s" << std::endl;
+#endif
+#endif
+
+	std::mt19937_64 rng(1);
+	std::vector<uint8_t> message(80);
+	for (uint8_t& b : message) {
+		b = rng();
+	}
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t k = 0; k < hashes; k++) {
+		message[79] = k;
+		Sha256<bool> h;
+		h.Write(message.data(), message.size());
+		h.Finalize();
+	}
+	std::cout << "Sha256<bool>, bytes: " << hashes / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " hashes/s" << std::endl;
+	std::cout << mismatches << " mismatches" << std::endl;
+
+	return mismatches ? 1 : 0;
+}
+
+/**
+ * Fixes a random 640-bit message except its last `free` bits, records the
+ * circuit, and turns it into a native kernel. Reports the compile (or cache
+ * load) time and the kernel's speed next to the interpreter's. One more
+ * batch of random inputs goes through both, which must agree word for word,
+ * and every one of its 64 lanes is checked against Sha256<bool>.
+ */
+int run_kernel(size_t free, size_t passes) {
+	Netlist net;
+
+	std::mt19937_64 rng(1);
+	std::vector<bool> message(640);
+	for (size_t i = 0; i < 640; i++) {
+		message[i] = rng() & 1;
+	}
+
+	std::unique_ptr<Sha256<GateRef>> sha = std::make_unique<Sha256<GateRef>>();
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(i < 640 - free ? (message[i] ? GateRef::one() : GateRef::zero()) : net.input(i - (640 - free)));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::vector<GateRef> outputs;
+	for (size_t i = 0; i < 256; i++) {
+		outputs.push_back(r[i].value());
+	}
+	const CompiledNetlist program(net, outputs);
+
+	auto start = std::chrono::steady_clock::now();
+	const Kernel kernel(program);
+	const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!kernel.good()) {
+		std::cerr << "kernel: " << kernel.error() << std::endl;
+		return 1;
+	}
+
+	std::vector<uint64_t> in(free), out(256), scratch;
+	auto speed = [&](auto&& evaluate) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < passes; k++) {
+			for (uint64_t& x : in) {
+				x = rng();
+			}
+			evaluate();
+		}
+		return 64 * passes / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+	const double interpreted = speed([&] { program.run(in.data(), out.data(), scratch); });
+	const double native = speed([&] { kernel(in.data(), out.data(), scratch); });
+
+	for (uint64_t& x : in) {
+		x = rng();
+	}
+	std::vector<uint64_t> expected(256);
+	program.run(in.data(), expected.data(), scratch);
+	kernel(in.data(), out.data(), scratch);
+	size_t mismatches = 0;
+	for (size_t i = 0; i < 256; i++) {
+		mismatches += expected[i] != out[i];
+	}
+	for (size_t lane = 0; lane < 64; lane++) {
+		Sha256<bool> check;
+		for (size_t i = 0; i < 640; i++) {
+			check.Write(Bit<bool>(i < 640 - free ? bool(message[i]) : bool(in[i - (640 - free)] >> lane & 1)));
+		}
+		const auto& digest = check.Finalize();
+		for (size_t i = 0; i < 256; i++) {
+			mismatches += digest[i].value() != bool(out[i] >> lane & 1);
+		}
+	}
+
+	std::cout << "kernel: " << program.num_gates() << " gates, " << (kernel.compiled() ? "compiled" : "loaded") << " in " << build_seconds << " s from " << kernel.path() << std::endl;
+	std::cout << "kernel: " << native << " hashes/s native, " << interpreted << " hashes/s interpreted, " << mismatches << " mismatches" << std::endl;
+
+	return mismatches ? 1 : 0;
+}
+
+/** Algebraic degree and term count of every digest bit, keeping monomials up to max_degree. */
+int run_anf(size_t max_degree) {
+	Anf::set_max_degree(max_degree);
+
+	Trace trace;
+	std::unique_ptr<Sha256<Anf, 64, JsonRoundLog>> sha = std::make_unique<Sha256<Anf, 64, JsonRoundLog>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(Anf(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::cout << std::endl;
+	for (size_t i = 0; i < 256; i++) {
+		const Anf& x = r[i].value();
+		std::cout << "bit " << i << ": degree " << x.degree() << (x.truncated() ? "+" : "") << ", " << x.size() << " terms" << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * The default circuit with every gate cut to at most `budget` clauses per
+ * side: each digest bit gets a necessary condition (its CNF) and a
+ * sufficient one (its DNF) on the message bits.
+ */
+int run_bounded(size_t budget) {
 	using T = NormalForm<640>;
+	T::set_budget(budget);
 
-	std::cerr << "Start" << std::endl;
+	Trace trace;
+	std::unique_ptr<Sha256<T, 64, JsonRoundLog>> sha = std::make_unique<Sha256<T, 64, JsonRoundLog>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(T(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::cout << std::endl;
+	for (size_t i = 0; i < 256; i++) {
+		const T& x = r[i].value();
+		std::cout << "bit " << i << ": cnf " << x.cnf().size() << (x.cnf_exact() ? "" : " (over)") << ", dnf " << x.dnf().size() << (x.dnf_exact() ? "" : " (under)") << std::endl;
+	}
+	std::cout << "bounded: " << T::bounded() << " gates cut, " << T::dropped() << " clauses dropped" << std::endl;
+
+	return 0;
+}
+
+/**
+ * Exact BDDs of the digest bits when only the last `free` message bits are
+ * variables and the rest are zero, with sifting enabled and at most
+ * node_limit live nodes.
+ */
+int run_bdd(size_t free, size_t node_limit) {
+	Bdd bdd;
+	bdd.set_auto_reorder(true);
+	bdd.set_node_limit(node_limit);
+
+	std::unique_ptr<Sha256<BddRef>> sha = std::make_unique<Sha256<BddRef>>();
+
+	try {
+		for (size_t i = 0; i < 640; i++) {
+			sha->Write(i < 640 - free ? BddRef::zero() : bdd.input(i - (640 - free)));
+		}
+
+		const auto& r = sha->Finalize();
+
+		std::cout << std::endl;
+		for (size_t i = 0; i < 256; i++) {
+			const BddRef& x = r[i].value();
+			std::cout << "bit " << i << ": " << bdd.node_count(x) << " nodes, " << bdd.sat_count(x).to_string() << " of 2^" << bdd.num_vars() << " assignments" << std::endl;
+		}
+	} catch (const BddNodeLimit& e) {
+		std::cout << std::endl
+				  << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << bdd.size() << " nodes, " << bdd.gc_runs() << " collections, " << bdd.reorder_runs() << " reorderings" << std::endl;
+
+	return 0;
+}
+
+/**
+ * AIG of the digest when only the last `free` message bits are variables:
+ * every gate with a constant operand is folded before it reaches the graph.
+ * The same circuit built from plain AigLit, where Aig folds constants
+ * itself, is the baseline.
+ */
+int run_partial(size_t free) {
+	using T = Partial<AigLit>;
+
+	size_t plain_ands;
+	{
+		Aig aig;
+		std::unique_ptr<Sha256<AigLit>> sha = std::make_unique<Sha256<AigLit>>();
+		for (size_t i = 0; i < 640; i++) {
+			sha->Write(i < 640 - free ? Bit<AigLit>::zero() : Bit<AigLit>(aig.input(i - (640 - free))));
+		}
+		sha->Finalize();
+		plain_ands = aig.num_ands();
+	}
+
+	Aig aig;
 
 	std::unique_ptr<Sha256<T>> sha = std::make_unique<Sha256<T>>();
 
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(i < 640 - free ? T(false) : T(aig.input(i - (640 - free))));
+	}
+
+	sha->Finalize();
+
+	std::cout << std::endl
+			  << "partial: " << T::folded() << " gates folded, " << T::symbolic() << " symbolic; aig: " << aig.num_ands()
+			  << " ands, " << plain_ands << " without folding" << std::endl;
+
+	return 0;
+}
+
+/** Writes the 640-input circuit as DIMACS with the first `zeros` digest bits pinned to zero. */
+int run_cnf(const std::string& path, size_t zeros) {
+	DimacsWriter out(path);
+	if (!out.good()) {
+		std::cerr << "cannot open " << path << std::endl;
+		return 1;
+	}
+	CnfEncoder enc(out, 640);
+
+	out.comment("inputs: variables 1..640, message bit order");
+
+	std::unique_ptr<Sha256<CnfLit>> sha = std::make_unique<Sha256<CnfLit>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(enc.input(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	for (size_t i = 0; i < 256; i++) {
+		const CnfLit l = r[i].value();
+		out.comment("output " + std::to_string(i) + " = " + (l.is_const() ? std::string(l.negated() ? "true" : "false") : std::to_string(l.dimacs())));
+	}
+
+	for (size_t i = 0; i < zeros && i < 256; i++) {
+		enc.constrain(r[i].value(), false);
+	}
+
+	out.close(enc.num_vars());
+
+	std::cout << std::endl
+			  << "cnf: " << enc.num_vars() << " variables, " << out.num_clauses() << " clauses" << std::endl;
+
+	return 0;
+}
+
+/**
+ * Encodes the 640-input circuit once into the embedded solver, then asks for
+ * 1..zeros leading zero digest bits with only the last 32 input bits free,
+ * reusing the clause database and learnt clauses between queries.
+ */
+int run_solve(size_t zeros) {
+	Solver solver;
+	CnfEncoder enc(solver, 640);
+
+	std::unique_ptr<Sha256<CnfLit>> sha = std::make_unique<Sha256<CnfLit>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(enc.input(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::cout << std::endl;
+
+	for (size_t k = 1; k <= zeros && k <= 256; k++) {
+		std::vector<CnfLit> assumptions;
+		for (size_t i = 0; i < 640 - 32; i++) {
+			assumptions.push_back(~enc.input(i));
+		}
+		for (size_t i = 0; i < k; i++) {
+			assumptions.push_back(~r[i].value());
+		}
+
+		const Solver::Result res = solver.solve(assumptions);
+
+		std::cout << k << " zero bits: ";
+		if (res == Solver::Result::sat) {
+			uint32_t nonce = 0;
+			for (size_t i = 640 - 32; i < 640; i++) {
+				nonce = (nonce << 1) | (solver.model_value(enc.input(i)) ? 1 : 0);
+			}
+			std::cout << "nonce 0x" << std::hex << nonce << std::dec;
+		} else {
+			std::cout << (res == Solver::Result::unsat ? "unsat" : "unknown");
+		}
+		std::cout << " (" << solver.conflicts() << " conflicts)" << std::endl;
+	}
+
+	return 0;
+}
+
+/** Concrete SHA-256 of a file, read through a memory map. */
+int run_file(const std::string& path) {
+	MappedFile file(path);
+	if (!file.good()) {
+		std::cerr << "cannot read " << path << std::endl;
+		return 1;
+	}
+
+	Sha256<bool> sha;
+	sha.Write(file.data(), file.size());
+
+	std::cout << Word<bool, 256>(sha.Finalize()) << std::endl;
+
+	return 0;
+}
+
+/**
+ * The 640-bit hash with its last `free` message bits symbolic, compressed
+ * a round at a time with a checkpoint written to path after every round.
+ * If path already holds a checkpoint of a run with the same `free`, the
+ * run resumes from it; one from another run is an error.
+ */
+int run_checkpoint(const std::string& path, size_t free) {
+	constexpr size_t N = 8;
+	using T = NormalForm<N>;
+	using sha_t = Sha256<T>;
+
+	free = std::min(free, N);
+	std::mt19937_64 rng(1);
+	sha_t::block_t blocks[2];
+	for (size_t i = 0; i < 640; i++) {
+		const bool b = rng() & 1;
+		blocks[i / 512][i % 512] = i < 640 - free ? Bit<T>(T(b)) : Bit<T>(T(i - (640 - free)));
+	}
+	blocks[1][128] = Bit<T>(T(true));
+	for (size_t i = 129; i < 512 - 32; i++) {
+		blocks[1][i] = Bit<T>(T(false));
+	}
+	for (size_t i = 0; i < 32; i++) {
+		blocks[1][512 - 32 + i] = Bit<T>(T(bool((640u >> (31 - i)) & 1)));
+	}
+
+	sha_t::RoundState r;
+	size_t block = 0;
+	const Checkpoint checkpoint(path);
+	if (checkpoint.good() && checkpoint.run() != free) {
+		std::cerr << path << " belongs to a run with " << checkpoint.run() << " free bits, not " << free << std::endl;
+		return 1;
+	}
+	if (checkpoint.good() && checkpoint.get_round_state(r)) {
+		block = checkpoint.tag();
+		std::cerr << "resuming block " << block << " after round " << r.round << std::endl;
+	} else {
+		r = sha_t::Begin(sha_t::InitialState(), blocks[0]);
+	}
+
+	for (;;) {
+		while (sha_t::Step(r)) {
+			CheckpointWriter<N> writer;
+			writer.add_round_state(r);
+			if (!writer.write(path, block, r.round, free)) {
+				std::cerr << "cannot write " << path << std::endl;
+				return 1;
+			}
+		}
+		if (++block == 2) {
+			break;
+		}
+		r = sha_t::Begin(r.chain, blocks[block]);
+	}
+
+	size_t clauses = 0;
+	for (size_t j = 0; j < 8; j++) {
+		for (size_t i = 0; i < 32; i++) {
+			clauses += BitMetrics<T>::size(r.chain(j)[i].value());
+		}
+	}
+	std::cout << "checkpoint: digest has " << clauses << " clauses" << std::endl;
+
+	return 0;
+}
+
+/** The original run: both normal forms of every gate, printed for the first digest bit. */
+template <typename T>
+int run_nf() {
+	Trace trace;
+	std::unique_ptr<Sha256<T, 64, JsonRoundLog>> sha = std::make_unique<Sha256<T, 64, JsonRoundLog>>();
+
 	for (size_t i = 0; i < 640; i++) {
 		sha->Write(T(i));
 	}
@@ -89,4 +836,118 @@ int main() {
 	std::cout << r[0].value();
 
 	return 0;
+}
+
+/** The default run on interned values, with the cache's statistics at the end. */
+int run_interned() {
+	using T = InternedNormalForm<640>;
+	const int r = run_nf<T>();
+	std::cerr << "interned: " << T::hits() << " cache hits, " << T::misses() << " gates computed, "
+			  << T::shared() << " duplicate values, " << T::size() << " live" << std::endl;
+	return r;
+}
+
+/** Same circuit as the default run, but only the CNF of the first digest bit is ever materialized. */
+int run_lazy() {
+	using T = LazyNormalForm<640>;
+
+	std::unique_ptr<Sha256<T>> sha = std::make_unique<Sha256<T>>();
+
+	for (size_t i = 0; i < 640; i++) {
+		sha->Write(T(i));
+	}
+
+	const auto& r = sha->Finalize();
+
+	std::cout << "cnf: " << cluase_set_to_string(r[0].value().cnf(), " | ", " & ") << std::endl;
+
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	const std::string backend = argc > 1 ? argv[1] : "nf";
+
+	std::cerr << "Start" << std::endl;
+
+	if (backend == "aig") {
+		return run_aig();
+	}
+
+	if (backend == "bitslice") {
+		return run_bitslice(argc > 2 ? std::stoul(argv[2]) : 4096, argc > 3 ? std::stoul(argv[3]) : 80);
+	}
+
+	if (backend == "netlist") {
+		return run_netlist(argc > 2 ? std::stoul(argv[2]) : 1000);
+	}
+
+	if (backend == "checkpoint") {
+		if (argc < 3) {
+			std::cerr << "usage: " << argv[0] << " checkpoint <path> [free]" << std::endl;
+			return 1;
+		}
+		return run_checkpoint(argv[2], argc > 3 ? std::stoul(argv[3]) : 4);
+	}
+
+	if (backend == "cone") {
+		return run_cone(argc > 2 ? std::stoul(argv[2]) : 32);
+	}
+
+	if (backend == "kernel") {
+		return run_kernel(argc > 2 ? std::stoul(argv[2]) : 32, argc > 3 ? std::stoul(argv[3]) : 1000);
+	}
+
+	if (backend == "rounds") {
+		return run_rounds(std::make_index_sequence<8>());
+	}
+
+	if (backend == "bdd") {
+		return run_bdd(argc > 2 ? std::stoul(argv[2]) : 12, argc > 3 ? std::stoul(argv[3]) : 1u << 24);
+	}
+
+	if (backend == "bounded") {
+		return run_bounded(argc > 2 ? std::stoul(argv[2]) : 64);
+	}
+
+	if (backend == "anf") {
+		return run_anf(argc > 2 ? std::stoul(argv[2]) : 1);
+	}
+
+	if (backend == "sparse") {
+		return run_nf<NormalForm<640, SparseClause<640>>>();
+	}
+
+	if (backend == "interned") {
+		return run_interned();
+	}
+
+	if (backend == "lazy") {
+		return run_lazy();
+	}
+
+	if (backend == "partial") {
+		return run_partial(argc > 2 ? std::stoul(argv[2]) : 32);
+	}
+
+	if (backend == "solve") {
+		return run_solve(argc > 2 ? std::stoul(argv[2]) : 8);
+	}
+
+	if (backend == "cnf") {
+		if (argc < 3) {
+			std::cerr << "usage: " << argv[0] << " cnf <out.cnf> [leading zero bits]" << std::endl;
+			return 1;
+		}
+		return run_cnf(argv[2], argc > 3 ? std::stoul(argv[3]) : 0);
+	}
+
+	if (backend == "file") {
+		if (argc < 3) {
+			std::cerr << "usage: " << argv[0] << " file <path>" << std::endl;
+			return 1;
+		}
+		return run_file(argv[2]);
+	}
+
+	return run_nf<NormalForm<640>>();
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef DESHA256_MAPPED_FILE_H_
+#define DESHA256_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Read-only memory map of a whole file, for feeding it to Sha256::Write() without copies. */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return;
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) == 0) {
+			size_ = static_cast<size_t>(st.st_size);
+			if (size_ == 0) {
+				good_ = true;
+			} else {
+				void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p != MAP_FAILED) {
+					::madvise(p, size_, MADV_SEQUENTIAL);
+					data_ = static_cast<const uint8_t*>(p);
+					good_ = true;
+				}
+			}
+		}
+		::close(fd);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool good() const { return good_; }
+
+	const uint8_t* data() const { return data_; }
+	size_t size() const { return size_; }
+
+	~MappedFile() {
+		if (data_) {
+			::munmap(const_cast<uint8_t*>(data_), size_);
+		}
+	}
+
+private:
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+	bool good_ = false;
+};
+
+#endif  // !DESHA256_MAPPED_FILE_H_
@@ -1,6 +1,7 @@
 #ifndef DESHA256_NESTED_CONTAINER_H_
 #define DESHA256_NESTED_CONTAINER_H_
 
+#include <algorithm>
 #include <array>
 
 template <typename FlatT, typename NestedT>
@@ -66,6 +67,12 @@ public:
 		return nested_[i][j];
 	}
 
+	/** Copies n bits starting at flat index pos. */
+	template <typename InputIt>
+	inline void assign(size_t pos, InputIt first, size_t n) {
+		std::copy_n(first, n, flat_.begin() + pos);
+	}
+
 	inline constexpr const flat_t& as_flat() const {
 		return flat_;
 	}
@@ -0,0 +1,395 @@
+#ifndef DESHA256_NETLIST_H_
+#define DESHA256_NETLIST_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bit.h"
+#include "context_stack.h"
+
+/** Reference to a netlist gate: gate index times two, plus one if complemented. */
+class GateRef {
+public:
+	constexpr GateRef() : lit_(0) {}
+	constexpr explicit GateRef(uint32_t lit) : lit_(lit) {}
+	constexpr GateRef(uint32_t var, bool negated) : lit_((var << 1) | (negated ? 1 : 0)) {}
+
+	constexpr uint32_t raw() const { return lit_; }
+	constexpr uint32_t var() const { return lit_ >> 1; }
+	constexpr bool negated() const { return lit_ & 1; }
+	constexpr bool is_const() const { return var() == 0; }
+
+	constexpr GateRef operator~() const { return GateRef(lit_ ^ 1); }
+
+	constexpr bool operator==(const GateRef& other) const { return lit_ == other.lit_; }
+	constexpr bool operator!=(const GateRef& other) const { return lit_ != other.lit_; }
+	constexpr bool operator<(const GateRef& other) const { return lit_ < other.lit_; }
+
+	static constexpr GateRef zero() { return GateRef(0); }
+	static constexpr GateRef one() { return GateRef(1); }
+
+private:
+	uint32_t lit_;
+};
+
+/**
+ * Structurally hashed netlist of two-input AND and XOR gates with free
+ * inversion on every edge, recorded once so it can be evaluated many times.
+ * Gate 0 is the constant; gates are created after their fanins, so gate
+ * order is a topological order. XOR is kept as a gate of its own since it
+ * dominates SHA-256 and would take three ANDs otherwise.
+ *
+ * Bit<GateRef> records into Netlist::current(), the most recently
+ * constructed live Netlist (or a process-wide default).
+ */
+class Netlist : public ContextStack<Netlist> {
+public:
+	enum class Op : uint8_t { constant, input, and_, xor_ };
+
+	struct Gate {
+		Op op;
+		uint32_t fanin0, fanin1;  // for inputs, fanin1 is the input index
+	};
+
+	Netlist() {
+		gates_.push_back({Op::constant, 0, 0});
+		table_.assign(1 << 10, 0);
+	}
+
+	Netlist(const Netlist&) = delete;
+	Netlist& operator=(const Netlist&) = delete;
+
+	static Netlist& current() {
+		if (!innermost()) {
+			static Netlist global;
+			return global;
+		}
+		return *innermost();
+	}
+
+	/** The i-th primary input, created on first use. */
+	GateRef input(size_t i) {
+		if (i >= inputs_.size()) {
+			inputs_.resize(i + 1, 0);
+		}
+		if (!inputs_[i]) {
+			inputs_[i] = static_cast<uint32_t>(gates_.size());
+			gates_.push_back({Op::input, 0, static_cast<uint32_t>(i)});
+		}
+		return GateRef(inputs_[i], false);
+	}
+
+	GateRef and_(GateRef a, GateRef b) {
+		if (b < a) {
+			std::swap(a, b);
+		}
+		if (a == GateRef::zero() || a == ~b) {
+			return GateRef::zero();
+		}
+		if (a == GateRef::one() || a == b) {
+			return b;
+		}
+		return GateRef(make(Op::and_, a, b), false);
+	}
+
+	GateRef or_(GateRef a, GateRef b) {
+		return ~and_(~a, ~b);
+	}
+
+	/** Complements are moved to the output, so the gate itself always sees plain fanins. */
+	GateRef xor_(GateRef a, GateRef b) {
+		const bool negated = a.negated() != b.negated();
+		a = GateRef(a.var(), false);
+		b = GateRef(b.var(), false);
+		if (b < a) {
+			std::swap(a, b);
+		}
+		if (a == b) {
+			return GateRef(0, negated);
+		}
+		if (a.is_const()) {
+			return GateRef(b.var(), negated);
+		}
+		return GateRef(make(Op::xor_, a, b), negated);
+	}
+
+	GateRef ite(GateRef s, GateRef d1, GateRef d0) {
+		if (s.is_const()) {
+			return s.negated() ? d1 : d0;
+		}
+		if (d1 == d0) {
+			return d1;
+		}
+		// d0 ^ (s & (d1 ^ d0)): two gates instead of three.
+		return xor_(d0, and_(s, xor_(d1, d0)));
+	}
+
+	/** Number of gates, including the constant and the inputs. */
+	size_t size() const { return gates_.size(); }
+	size_t num_inputs() const { return inputs_.size(); }
+
+	const Gate& gate(uint32_t var) const { return gates_[var]; }
+
+private:
+	uint32_t make(Op op, GateRef a, GateRef b) {
+		const size_t mask = table_.size() - 1;
+		size_t h = hash(op, a, b) & mask;
+		while (table_[h]) {
+			const Gate& g = gates_[table_[h]];
+			if (g.op == op && g.fanin0 == a.raw() && g.fanin1 == b.raw()) {
+				return table_[h];
+			}
+			h = (h + 1) & mask;
+		}
+
+		const uint32_t var = static_cast<uint32_t>(gates_.size());
+		gates_.push_back({op, a.raw(), b.raw()});
+		table_[h] = var;
+		if (2 * ++logic_ > table_.size()) {
+			rehash(table_.size() * 2);
+		}
+		return var;
+	}
+
+	static size_t hash(Op op, GateRef a, GateRef b) {
+		uint64_t h = (uint64_t(a.raw()) << 32) | b.raw();
+		h ^= static_cast<uint64_t>(op) << 62;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+
+	void rehash(size_t buckets) {
+		table_.assign(buckets, 0);
+		const size_t mask = buckets - 1;
+		for (uint32_t var = 1; var < gates_.size(); var++) {
+			const Gate& g = gates_[var];
+			if (g.op != Op::and_ && g.op != Op::xor_) {
+				continue;
+			}
+			size_t h = hash(g.op, GateRef(g.fanin0), GateRef(g.fanin1)) & mask;
+			while (table_[h]) {
+				h = (h + 1) & mask;
+			}
+			table_[h] = var;
+		}
+	}
+
+private:
+	std::vector<Gate> gates_;
+	std::vector<uint32_t> table_;
+	std::vector<uint32_t> inputs_;
+	size_t logic_ = 0;
+};
+
+template <>
+inline GateRef Bit<GateRef>::raw_zero() { return GateRef::zero(); }
+
+template <>
+inline GateRef Bit<GateRef>::raw_one() { return GateRef::one(); }
+
+template <>
+inline GateRef Bit<GateRef>::raw_not(const GateRef& a) { return ~a; }
+
+template <>
+inline GateRef Bit<GateRef>::raw_and(const GateRef& a, const GateRef& b) { return Netlist::current().and_(a, b); }
+
+template <>
+inline GateRef Bit<GateRef>::raw_or(const GateRef& a, const GateRef& b) { return Netlist::current().or_(a, b); }
+
+template <>
+inline GateRef Bit<GateRef>::raw_xor(const GateRef& a, const GateRef& b) { return Netlist::current().xor_(a, b); }
+
+template <>
+inline GateRef Bit<GateRef>::raw_ite(const GateRef& s, const GateRef& d1, const GateRef& d0) { return Netlist::current().ite(s, d1, d0); }
+
+/**
+ * The part of a Netlist that feeds a given list of outputs, renumbered into
+ * one dense array of instructions in topological order. run() evaluates it
+ * for any word type W, one independent evaluation per bit of W: bool-like
+ * uint8_t for one input vector, uint64_t for 64 at once, or the vector types
+ * of bitslice.h for more.
+ *
+ * Slot 0 holds the constant and slots 1..num_inputs() the inputs; every
+ * instruction writes the next slot. An operand is a slot times two plus a
+ * complement bit, so inversions cost one xor with a mask.
+ *
+ * run() does not keep one slot per gate: a gate's slot is handed to a later
+ * gate once its last reader is done, which shrinks the SHA-256 circuit's
+ * 222k slots to under 2k: 14 KB of scratch at 64 lanes instead of 1.8 MB.
+ * AND and XOR are picked with a mask instead of a branch.
+ */
+class CompiledNetlist {
+public:
+	CompiledNetlist(const Netlist& net, const std::vector<GateRef>& outputs) : inputs_(net.num_inputs()) {
+		// Mark the cone of the outputs; fanins always come before a gate.
+		std::vector<char> live(net.size(), 0);
+		for (const GateRef& o : outputs) {
+			live[o.var()] = 1;
+		}
+		for (size_t var = net.size(); var-- > 1;) {
+			const Netlist::Gate& g = net.gate(static_cast<uint32_t>(var));
+			if (live[var] && (g.op == Netlist::Op::and_ || g.op == Netlist::Op::xor_)) {
+				live[GateRef(g.fanin0).var()] = 1;
+				live[GateRef(g.fanin1).var()] = 1;
+			}
+		}
+
+		std::vector<uint32_t> slot(net.size(), 0);
+		uint32_t next = static_cast<uint32_t>(inputs_ + 1);
+		for (uint32_t var = 1; var < net.size(); var++) {
+			const Netlist::Gate& g = net.gate(var);
+			if (g.op == Netlist::Op::input) {
+				slot[var] = g.fanin1 + 1;
+			} else if (live[var]) {
+				code_.push_back({g.op == Netlist::Op::xor_, remap(slot, g.fanin0), remap(slot, g.fanin1)});
+				slot[var] = next++;
+			}
+		}
+
+		for (const GateRef& o : outputs) {
+			outputs_.push_back(remap(slot, o.raw()));
+		}
+
+		allocate_slots();
+	}
+
+	size_t num_inputs() const { return inputs_; }
+	size_t num_outputs() const { return outputs_.size(); }
+	size_t num_gates() const { return code_.size(); }
+
+	/** Calls fn(slot, is_xor, a, b) for every instruction in order; a and b are operands as described above. */
+	template <typename Fn>
+	void for_each_gate(Fn fn) const {
+		uint32_t slot = static_cast<uint32_t>(1 + inputs_);
+		for (const Instr& in : code_) {
+			fn(slot++, in.xor_, in.a, in.b);
+		}
+	}
+
+	/** Operand holding output k. */
+	uint32_t output(size_t k) const { return outputs_[k]; }
+
+	/** Slots run() needs; num_gates() of them are gates before reuse. */
+	size_t num_slots() const { return slots_; }
+
+	/** Evaluates with inputs[i] holding input i and writes output k to outputs[k]; scratch is reused between calls. */
+	template <typename W>
+	void run(const W* inputs, W* outputs, std::vector<W>& scratch) const {
+		const W mask[2] = {W{}, static_cast<W>(~W{})};
+
+		scratch.resize(slots_);
+		W* v = scratch.data();
+		v[0] = W{};
+		std::copy(inputs, inputs + inputs_, v + 1);
+
+		for (const Step& s : steps_) {
+			const uint32_t op_a = s.a & ~kXor;
+			const W a = v[op_a >> 1] ^ mask[op_a & 1];
+			const W b = v[s.b >> 1] ^ mask[s.b & 1];
+			// a & b ^ (a | b) is a ^ b.
+			v[s.out] = (a & b) ^ ((a | b) & mask[s.a >> 31]);
+		}
+
+		for (size_t k = 0; k < run_outputs_.size(); k++) {
+			outputs[k] = v[run_outputs_[k] >> 1] ^ mask[run_outputs_[k] & 1];
+		}
+	}
+
+	template <typename W>
+	void run(const W* inputs, W* outputs) const {
+		std::vector<W> scratch;
+		run(inputs, outputs, scratch);
+	}
+
+	/** One evaluation. */
+	std::vector<bool> operator()(const std::vector<bool>& inputs) const {
+		std::vector<uint8_t> in(inputs_), out(outputs_.size());
+		for (size_t i = 0; i < inputs_ && i < inputs.size(); i++) {
+			in[i] = inputs[i] ? 1 : 0;
+		}
+		run(in.data(), out.data());
+		std::vector<bool> r(out.size());
+		for (size_t k = 0; k < out.size(); k++) {
+			r[k] = out[k] & 1;
+		}
+		return r;
+	}
+
+private:
+	struct Instr {
+		bool xor_;
+		uint32_t a, b;
+	};
+
+	/** An instruction of run(): operands as in Instr, the top bit of a set for XOR. */
+	struct Step {
+		uint32_t a, b, out;
+	};
+
+	static constexpr uint32_t kXor = uint32_t(1) << 31;
+
+	static uint32_t remap(const std::vector<uint32_t>& slot, uint32_t lit) {
+		return (slot[lit >> 1] << 1) | (lit & 1);
+	}
+
+	/** Renumbers code_ into steps_, giving each gate the slot of a gate nobody reads any more. */
+	void allocate_slots() {
+		const uint32_t first = static_cast<uint32_t>(1 + inputs_);
+		const uint32_t end = first + static_cast<uint32_t>(code_.size());
+
+		// Last instruction reading each gate; outputs are read after all of them.
+		std::vector<uint32_t> last_use(end, 0);
+		for_each_gate([&](uint32_t slot, bool, uint32_t a, uint32_t b) {
+			last_use[a >> 1] = slot;
+			last_use[b >> 1] = slot;
+		});
+		for (uint32_t o : outputs_) {
+			last_use[o >> 1] = end;
+		}
+
+		std::vector<uint32_t> where(end);
+		for (uint32_t i = 0; i < first; i++) {
+			where[i] = i;
+		}
+		std::vector<uint32_t> free_slots;
+		uint32_t next = first;
+		for_each_gate([&](uint32_t slot, bool is_xor, uint32_t a, uint32_t b) {
+			const Step step = {remap(where, a) | (is_xor ? kXor : 0), remap(where, b), 0};
+			// Operands are read before the result is written, so a dying operand's slot can take it.
+			for (uint32_t x : {a >> 1, b >> 1}) {
+				if (x >= first && last_use[x] == slot) {
+					free_slots.push_back(where[x]);
+					last_use[x] = 0;
+				}
+			}
+			if (free_slots.empty()) {
+				where[slot] = next++;
+			} else {
+				where[slot] = free_slots.back();
+				free_slots.pop_back();
+			}
+			steps_.push_back(step);
+			steps_.back().out = where[slot];
+		});
+		slots_ = next;
+
+		for (uint32_t o : outputs_) {
+			run_outputs_.push_back(remap(where, o));
+		}
+	}
+
+private:
+	size_t inputs_;
+	std::vector<Instr> code_;
+	std::vector<uint32_t> outputs_;
+
+	std::vector<Step> steps_;
+	std::vector<uint32_t> run_outputs_;
+	size_t slots_ = 0;
+};
+
+#endif  // !DESHA256_NETLIST_H_
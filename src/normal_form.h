@@ -2,18 +2,46 @@
 #define DESHA256_NORMAL_FORM_H_
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
 #include <vector>
 
+#include "bit.h"
 #include "clause.h"
-
-template <size_t N>
+#include "sparse_clause.h"
+#include "spill.h"
+#include "subsumption.h"
+#include "thread_pool.h"
+
+template <size_t N, typename ClauseT>
+class LazyNormalForm;
+
+/**
+ * Clause set pair over N variables; ClauseT may be Clause<N> or SparseClause<N>.
+ *
+ * When budget() is set, a gate whose CNF or DNF comes out with more clauses
+ * than that keeps only the shortest ones. Dropping CNF clauses can only
+ * weaken it and dropping DNF terms can only strengthen it, and ~, & and |
+ * all preserve "f implies cnf()" and "dnf() implies f" (~ swaps the two
+ * sides along with their roles). So cnf() is always a sound
+ * over-approximation, a necessary condition, and dnf() a sound
+ * under-approximation, a sufficient one. cnf_exact() and dnf_exact() say
+ * whether a side still is exact, i.e. no gate in its cone was cut, and
+ * dropped() and bounded() count the clauses and gates cut so far.
+ */
+template <size_t N, typename ClauseT = Clause<N>>
 class NormalForm {
 private:
-	using normal_form_t = NormalForm<N>;
-	using clause_t = Clause<N>;
-	using clause_set_t = std::vector<clause_t>;
+	using normal_form_t = NormalForm<N, ClauseT>;
+	using clause_t = ClauseT;
+	using clause_set_t = spill_vector<clause_t>;
 
 public:
+	using clause_type = ClauseT;
+	using clause_set_type = clause_set_t;
+	static constexpr size_t variables = N;
+
 	NormalForm() {}
 	NormalForm(const clause_set_t& cnf, const clause_set_t& dnf) : cnf_(cnf), dnf_(dnf) {}
 	NormalForm(size_t i) {
@@ -21,36 +49,29 @@ public:
 		dnf_.emplace_back(i);
 	}
 	NormalForm(bool b) {
+		// true is the empty conjunction / the empty term, false the empty clause / the empty disjunction.
 		if (b) {
-			cnf_.emplace_back();
 			dnf_.emplace_back();
+		} else {
+			cnf_.emplace_back();
 		}
 	}
 
 	normal_form_t operator~() const {
-		clause_set_t d, c;
-
-		d.reserve(cnf_.size());
-		std::transform(cnf_.begin(), cnf_.end(), std::back_inserter(d), [](const clause_t& x) {
-			return x.flip();
-		});
-		d.shrink_to_fit();
-
-		c.reserve(dnf_.size());
-		std::transform(dnf_.begin(), dnf_.end(), std::back_inserter(c), [](const clause_t& x) {
-			return x.flip();
-		});
-		c.shrink_to_fit();
+		return {flip(dnf_), flip(cnf_), dnf_exact_, cnf_exact_};
+	}
 
-		return {c, d};
+	/** Same as ~, for the generic Bit<T>::raw_not(). */
+	normal_form_t operator!() const {
+		return ~*this;
 	}
 
 	normal_form_t operator&(const normal_form_t& other) const {
-		return {cat(cnf_, other.cnf_), product(dnf_, other.dnf_)};
+		return {cat(cnf_, other.cnf_), product(dnf_, other.dnf_), cnf_exact_ && other.cnf_exact_, dnf_exact_ && other.dnf_exact_};
 	}
 
 	normal_form_t operator|(const normal_form_t& other) const {
-		return {product(cnf_, other.cnf_), cat(dnf_, other.dnf_)};
+		return {product(cnf_, other.cnf_), cat(dnf_, other.dnf_), cnf_exact_ && other.cnf_exact_, dnf_exact_ && other.dnf_exact_};
 	}
 
 	normal_form_t operator^(const normal_form_t& other) const {
@@ -65,41 +86,174 @@ public:
 		return dnf_;
 	}
 
+	/**
+	 * Sorts both sides into one fixed clause order, after which equal clause
+	 * sets are equal element by element; see interned_normal_form.h.
+	 */
+	void canonicalize() {
+		canonicalize(cnf_);
+		canonicalize(dnf_);
+	}
+
+	/** Equal for equal values; only meaningful across canonicalized ones. */
+	size_t hash() const {
+		uint64_t h = (cnf_exact_ ? 1 : 0) | (dnf_exact_ ? 2 : 0);
+		for (const clause_set_t* side : {&cnf_, &dnf_}) {
+			h = mix(h ^ side->size());
+			for (const clause_t& x : *side) {
+				h = mix(h ^ x.signature());
+			}
+		}
+		return static_cast<size_t>(h);
+	}
+
+	bool operator==(const normal_form_t& other) const {
+		return cnf_exact_ == other.cnf_exact_ && dnf_exact_ == other.dnf_exact_ && cnf_ == other.cnf_ && dnf_ == other.dnf_;
+	}
+
+	/** Whether cnf() is f itself rather than an over-approximation. */
+	bool cnf_exact() const { return cnf_exact_; }
+	/** Whether dnf() is f itself rather than an under-approximation. */
+	bool dnf_exact() const { return dnf_exact_; }
+	bool exact() const { return cnf_exact_ && dnf_exact_; }
+
+	/** A value as saved earlier, exactness included; nothing is cut to budget(). */
+	static normal_form_t restore(clause_set_t cnf, clause_set_t dnf, bool cnf_exact, bool dnf_exact) {
+		normal_form_t r;
+		r.cnf_ = std::move(cnf);
+		r.dnf_ = std::move(dnf);
+		r.cnf_exact_ = cnf_exact;
+		r.dnf_exact_ = dnf_exact;
+		return r;
+	}
+
+	/** Most clauses a gate keeps per side; unlimited by default. */
+	static size_t budget() { return budget_; }
+	static void set_budget(size_t clauses) { budget_ = clauses; }
+
+	static size_t dropped() { return dropped_; }
+	static size_t bounded() { return bounded_; }
+
+	static void reset_counters() {
+		dropped_ = 0;
+		bounded_ = 0;
+	}
+
 	~NormalForm() {}
 
 private:
-	static clause_set_t absorb(const clause_set_t& a) {
-		if (a.size() <= 1) {
-			return a;
+	friend class LazyNormalForm<N, ClauseT>;
+
+	/** Result of a gate whose operands' sides were exact as given; both sides are cut to budget(). */
+	NormalForm(clause_set_t cnf, clause_set_t dnf, bool cnf_exact, bool dnf_exact)
+		: cnf_(std::move(cnf)), dnf_(std::move(dnf)), cnf_exact_(bound(cnf_) && cnf_exact), dnf_exact_(bound(dnf_) && dnf_exact) {}
+
+	/**
+	 * Keeps the budget() shortest clauses of a, in their original order;
+	 * false if anything had to go. A subset of an absorbed set is still
+	 * absorbed, so nothing else needs redoing.
+	 */
+	static bool bound(clause_set_t& a) {
+		if (a.size() <= budget_) {
+			return true;
 		}
 
-		std::vector<char> keep(a.size(), '\x01');
-
-		for (size_t i = 0; i < a.size() - 1; i++) {
-			if (!keep[i]) {
-				continue;
+		std::vector<size_t> sizes;
+		sizes.reserve(a.size());
+		for (const clause_t& x : a) {
+			sizes.push_back(x.size());
+		}
+		std::vector<size_t> sorted = sizes;
+		std::nth_element(sorted.begin(), sorted.begin() + budget_, sorted.end());
+		const size_t cut = sorted[budget_];
+		// Clauses shorter than cut all fit; longer ones never do; ties go to the earliest.
+		size_t ties = budget_ - std::count_if(sizes.begin(), sizes.end(), [cut](size_t n) { return n < cut; });
+
+		dropped_ += a.size() - budget_;
+		bounded_++;
+		size_t n = 0;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (sizes[i] < cut || (sizes[i] == cut && ties && ties--)) {
+				if (n != i) {
+					a[n] = std::move(a[i]);
+				}
+				n++;
 			}
+		}
+		a.resize(n);
+		return false;
+	}
 
-			for (size_t j = i + 1; j < a.size(); j++) {
-				if (a[i].includes(a[j])) {
-					keep[i] = '\0';
-					break;
-				}
+	static uint64_t mix(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
 
-				if (a[j].includes(a[i])) {
-					keep[j] = '\0';
-				}
+	/** Literals of x in increasing order. */
+	static std::vector<uint32_t> sorted_literals(const clause_t& x) {
+		std::vector<uint32_t> r;
+		x.for_each_literal([&r](size_t lit) {
+			r.push_back(static_cast<uint32_t>(lit));
+		});
+		std::sort(r.begin(), r.end());
+		return r;
+	}
+
+	/**
+	 * Orders by size, then signature, then the sorted literal lists, which
+	 * are only built on ties. Short clauses first is also the order in which
+	 * later absorption passes do the least work.
+	 */
+	static void canonicalize(clause_set_t& a) {
+		struct Key {
+			size_t size;
+			uint64_t signature;
+			uint32_t index;
+		};
+		std::vector<Key> keys;
+		keys.reserve(a.size());
+		for (size_t i = 0; i < a.size(); i++) {
+			keys.push_back({a[i].size(), a[i].signature(), static_cast<uint32_t>(i)});
+		}
+		std::sort(keys.begin(), keys.end(), [&a](const Key& x, const Key& y) {
+			if (x.size != y.size) {
+				return x.size < y.size;
 			}
+			if (x.signature != y.signature) {
+				return x.signature < y.signature;
+			}
+			return sorted_literals(a[x.index]) < sorted_literals(a[y.index]);
+		});
+
+		clause_set_t r;
+		r.reserve(a.size());
+		for (const Key& k : keys) {
+			r.push_back(std::move(a[k.index]));
 		}
+		a.swap(r);
+	}
 
+	static clause_set_t flip(const clause_set_t& a) {
 		clause_set_t r;
 		r.reserve(a.size());
-		size_t i = 0;
-		std::copy_if(a.begin(), a.end(), std::back_inserter(r), [&keep, &i](const clause_t& x) {
-			return keep[i++];
+		std::transform(a.begin(), a.end(), std::back_inserter(r), [](const clause_t& x) {
+			return x.flip();
 		});
-		r.shrink_to_fit();
-		return a;
+		return r;
+	}
+
+	static clause_set_t absorb(const clause_set_t& a) {
+		if (a.size() <= 1) {
+			return a;
+		}
+
+		SubsumptionIndex<clause_t> index(2 * N);
+		for (const clause_t& x : a) {
+			index.insert(x, x.signature());
+		}
+		return index.take();
 	}
 
 	static clause_set_t cat(const clause_set_t& a, const clause_set_t& b) {
@@ -110,55 +264,104 @@ private:
 		return absorb(r);
 	}
 
+	/**
+	 * Cross product of two clause sets, minus clashing and subsumed clauses.
+	 * Large products are cut into contiguous ranges of the row-major pair
+	 * order, each filtered on its own thread; neighbouring ranges are then
+	 * merged pairwise, also in parallel. Every merge keeps the survivors in
+	 * first-occurrence order, so the result is the sequential one, clause for
+	 * clause.
+	 */
 	static clause_set_t product(const clause_set_t& a, const clause_set_t& b) {
-		clause_set_t r;
-		r.reserve(a.size() * b.size());
-
-		std::vector<bool> keep_vec(a.size() * b.size(), true);
+		const std::vector<uint64_t> sa = signatures(a), sb = signatures(b);
+		const size_t pairs = a.size() * b.size();
+
+		ThreadPool& pool = ThreadPool::shared();
+		if (pairs < kParallelPairs || pool.size() == 1) {
+			clause_set_t r = product_range(a, sa, b, sb, 0, pairs);
+			r.shrink_to_fit();
+			return r;
+		}
 
-		for (const clause_t& i : a) {
-			for (const clause_t& j : b) {
-				const clause_t x = i | j;
+		const size_t chunks = std::min(4 * pool.size(), pairs / (kParallelPairs / 4));
+		std::vector<clause_set_t> parts(chunks);
+		pool.parallel_for(chunks, [&](size_t k) {
+			parts[k] = product_range(a, sa, b, sb, pairs * k / chunks, pairs * (k + 1) / chunks);
+		});
 
-				if (!x.valid()) {
-					continue;
+		while (parts.size() > 1) {
+			std::vector<clause_set_t> merged((parts.size() + 1) / 2);
+			pool.parallel_for(merged.size(), [&](size_t k) {
+				if (2 * k + 1 < parts.size()) {
+					merged[k] = merge(parts[2 * k], parts[2 * k + 1]);
+					// Free the inputs now rather than after the whole level, to keep the peak down.
+					clause_set_t().swap(parts[2 * k]);
+					clause_set_t().swap(parts[2 * k + 1]);
+				} else {
+					merged[k] = std::move(parts[2 * k]);
 				}
+			});
+			parts.swap(merged);
+		}
 
-				bool keep = true;
-
-				for (size_t k = 0; k < r.size(); k++) {
-					if (!keep_vec[k]) {
-						continue;
-					}
-
-					if (x.includes(r[k])) {
-						keep = false;
-						break;
-					}
+		clause_set_t r = std::move(parts[0]);
+		r.shrink_to_fit();
+		return r;
+	}
 
-					if (r[k].includes(x)) {
-						keep_vec[k] = false;
-					}
+	/** Filtered products of the pairs lo..hi-1, pair p being (a[p / |b|], b[p % |b|]). */
+	static clause_set_t product_range(const clause_set_t& a, const std::vector<uint64_t>& sa,
+									  const clause_set_t& b, const std::vector<uint64_t>& sb, size_t lo, size_t hi) {
+		SubsumptionIndex<clause_t> index(2 * N);
+		for (size_t p = lo; p < hi;) {
+			const size_t i = p / b.size();
+			const size_t j_end = std::min(b.size(), hi - i * b.size());
+			for (size_t j = p % b.size(); j < j_end; j++, p++) {
+				if (a[i].clashes(b[j])) {
+					continue;
 				}
 
-				if (keep) {
-					r.push_back(x);
-				}
+				index.insert(a[i] | b[j], sa[i] | sb[j]);
 			}
 		}
+		return index.take();
+	}
 
-		size_t i = 0;
-		r.erase(std::remove_if(r.begin(), r.end(), [&i, &keep_vec](const clause_t& x) {
-			return !keep_vec[i++];
-		}), r.end());
-
-		r.shrink_to_fit();
+	/** Survivors of x followed by y, in order. */
+	static clause_set_t merge(const clause_set_t& x, const clause_set_t& y) {
+		SubsumptionIndex<clause_t> index(2 * N);
+		for (const clause_set_t* part : {&x, &y}) {
+			for (const clause_t& c : *part) {
+				index.insert(c, c.signature());
+			}
+		}
+		return index.take();
+	}
 
+	static std::vector<uint64_t> signatures(const clause_set_t& a) {
+		std::vector<uint64_t> r;
+		r.reserve(a.size());
+		for (const clause_t& x : a) {
+			r.push_back(x.signature());
+		}
 		return r;
 	}
 
 private:
+	static constexpr size_t kParallelPairs = size_t(1) << 15;
+
+	inline static size_t budget_ = std::numeric_limits<size_t>::max();
+	inline static size_t dropped_ = 0;
+	inline static size_t bounded_ = 0;
+
 	clause_set_t cnf_, dnf_;
+	bool cnf_exact_ = true, dnf_exact_ = true;
+};
+
+template <size_t N, typename ClauseT>
+struct BitMetrics<NormalForm<N, ClauseT>> {
+	static constexpr const char* unit = "clauses";
+	static size_t size(const NormalForm<N, ClauseT>& x) { return x.cnf().size() + x.dnf().size(); }
 };
 
 #endif  // !DESHA256_NORMAL_FORM_H_
@@ -0,0 +1,85 @@
+#ifndef DESHA256_PACKED_CONTAINER_H_
+#define DESHA256_PACKED_CONTAINER_H_
+
+#include <array>
+
+#include "word.h"
+
+/**
+ * NestedContainer counterpart for packed Word<bool, 32>: the flat bit view is
+ * produced on demand instead of aliasing the word storage.
+ */
+template <size_t N>
+class PackedContainer {
+private:
+	using packed_container_t = PackedContainer<N>;
+	using word_t = Word<bool, 32>;
+	using bit_t = Bit<bool>;
+	using flat_t = std::array<bit_t, N * 32>;
+	using nested_t = std::array<word_t, N>;
+
+public:
+	PackedContainer() : nested_() {}
+	PackedContainer(const packed_container_t& other) : nested_(other.nested_) {}
+	PackedContainer(const nested_t& nested) : nested_(nested) {}
+
+	inline packed_container_t& operator=(const packed_container_t& other) {
+		nested_ = other.nested_;
+		return *this;
+	}
+	inline packed_container_t& operator=(const nested_t& x) {
+		nested_ = x;
+		return *this;
+	}
+
+	inline bit_t operator[](size_t i) const {
+		return nested_[i / 32][i % 32];
+	}
+	inline word_t::reference operator[](size_t i) {
+		return nested_[i / 32][i % 32];
+	}
+
+	inline const word_t& operator()(size_t i) const {
+		return nested_[i];
+	}
+	inline word_t& operator()(size_t i) {
+		return nested_[i];
+	}
+
+	inline bit_t operator()(size_t i, size_t j) const {
+		return nested_[i][j];
+	}
+	inline word_t::reference operator()(size_t i, size_t j) {
+		return nested_[i][j];
+	}
+
+	/** Copies n bits starting at flat index pos. */
+	template <typename InputIt>
+	inline void assign(size_t pos, InputIt first, size_t n) {
+		for (size_t i = 0; i < n; i++, ++first) {
+			(*this)[pos + i] = *first;
+		}
+	}
+
+	flat_t as_flat() const {
+		flat_t r;
+		for (size_t i = 0; i < N * 32; i++) {
+			r[i] = (*this)[i];
+		}
+		return r;
+	}
+
+	inline const nested_t& as_nested() const {
+		return nested_;
+	}
+	inline nested_t& as_nested() {
+		return nested_;
+	}
+
+	~PackedContainer() {}
+
+private:
+	nested_t nested_;
+};
+
+#endif  // !DESHA256_PACKED_CONTAINER_H_
@@ -0,0 +1,129 @@
+#ifndef DESHA256_PARTIAL_H_
+#define DESHA256_PARTIAL_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include "bit.h"
+
+/**
+ * Partial evaluation on top of another bit type: a bit is either a known
+ * constant or a T. Gates with a constant operand fold to a constant, to the
+ * other operand or to its negation, so only gates between two unknown bits
+ * reach the backend; constants are turned into T only when value() asks.
+ *
+ * folded() counts binary gates that had a constant operand, symbolic() the
+ * ones passed down to T. Negation is free in every backend and counted in
+ * neither. The counters are plain statics shared by every Partial<T> in the
+ * process and are not thread-safe.
+ */
+template <typename T>
+class Partial {
+private:
+	using partial_t = Partial<T>;
+
+	enum class State : unsigned char { zero, one, unknown };
+
+public:
+	Partial() : state_(State::zero) {}
+	template <typename B, typename = std::enable_if_t<std::is_same_v<B, bool>>>
+	Partial(B b) : state_(b ? State::one : State::zero) {}
+	Partial(const T& val) : state_(State::unknown), val_(val) {}
+
+	bool known() const {
+		return state_ != State::unknown;
+	}
+
+	/** The constant; only meaningful if known(). */
+	bool constant() const {
+		return state_ == State::one;
+	}
+
+	/** The bit as a T, constants included. */
+	T value() const {
+		switch (state_) {
+			case State::zero:
+				return Bit<T>::raw_zero();
+			case State::one:
+				return Bit<T>::raw_one();
+			case State::unknown:
+				break;
+		}
+		return val_;
+	}
+
+	partial_t operator!() const {
+		if (known()) {
+			return !constant();
+		}
+		return partial_t(Bit<T>::raw_not(val_));
+	}
+
+	partial_t operator&(const partial_t& other) const {
+		if (known() || other.known()) {
+			folded_++;
+			const partial_t& k = known() ? *this : other;
+			return k.constant() ? (known() ? other : *this) : partial_t(false);
+		}
+		symbolic_++;
+		return partial_t(Bit<T>::raw_and(val_, other.val_));
+	}
+
+	partial_t operator|(const partial_t& other) const {
+		if (known() || other.known()) {
+			folded_++;
+			const partial_t& k = known() ? *this : other;
+			return k.constant() ? partial_t(true) : (known() ? other : *this);
+		}
+		symbolic_++;
+		return partial_t(Bit<T>::raw_or(val_, other.val_));
+	}
+
+	partial_t operator^(const partial_t& other) const {
+		if (known() || other.known()) {
+			folded_++;
+			const partial_t& k = known() ? *this : other;
+			const partial_t& x = known() ? other : *this;
+			if (!k.constant()) {
+				return x;
+			}
+			if (x.known()) {
+				return !x.constant();
+			}
+			return partial_t(Bit<T>::raw_not(x.val_));
+		}
+		symbolic_++;
+		return partial_t(Bit<T>::raw_xor(val_, other.val_));
+	}
+
+	static size_t folded() { return folded_; }
+	static size_t symbolic() { return symbolic_; }
+
+	static void reset_counters() {
+		folded_ = 0;
+		symbolic_ = 0;
+	}
+
+private:
+	friend struct BitMetrics<partial_t>;
+
+	inline static size_t folded_ = 0;
+	inline static size_t symbolic_ = 0;
+
+	State state_;
+	T val_;
+};
+
+/** Same adder as T, so the two build comparable circuits. */
+template <typename T>
+struct AdderTraits<Partial<T>> {
+	static constexpr AdderKind kind = AdderTraits<T>::kind;
+};
+
+template <typename T>
+struct BitMetrics<Partial<T>> {
+	static constexpr const char* unit = BitMetrics<T>::unit;
+	static size_t size(const Partial<T>& x) { return x.known() ? 0 : BitMetrics<T>::size(x.val_); }
+};
+
+#endif  // !DESHA256_PARTIAL_H_
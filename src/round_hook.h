@@ -0,0 +1,21 @@
+#ifndef DESHA256_ROUND_HOOK_H_
+#define DESHA256_ROUND_HOOK_H_
+
+#include <array>
+#include <cstddef>
+
+/**
+ * Sha256 round hooks. After every round the Hook parameter of Sha256 gets
+ * round(i, state, w): the round index within the block, the eight working
+ * words in a..h order as the next round sees them, and the schedule word
+ * the round consumed. Hooks that need more than this header live in
+ * instrumentation.h.
+ */
+
+/** The default hook: no code at all. */
+struct NoInstrumentation {
+	template <typename Word>
+	static void round(size_t, const std::array<const Word*, 8>&, const Word&) {}
+};
+
+#endif  // !DESHA256_ROUND_HOOK_H_
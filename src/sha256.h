@@ -2,47 +2,177 @@
 #define DESHA256_SHA256_H_
 
 #include <algorithm>
-#include <iostream>
+#include <bitset>
+#include <cstdint>
 
+#include "round_hook.h"
 #include "nested_container.h"
+#include "packed_container.h"
 #include "word.h"
 
-template <typename T>
+/** Storage for N words that can also be addressed as N * 32 consecutive bits. */
+template <typename T, size_t N>
+struct WordStorage {
+	using type = NestedContainer<std::array<Bit<T>, N * 32>, std::array<Word<T, 32>, N>>;
+};
+
+template <size_t N>
+struct WordStorage<bool, N> {
+	using type = PackedContainer<N>;
+};
+
+/**
+ * The part of one compression that can reach a chosen set of digest bits.
+ * Round r produces two new words, a and e, and reads the message schedule
+ * word w; a[r], e[r] and w[r] say which of them are computed. out says which
+ * state words get the feed-forward addition. Anything outside the cone is
+ * left stale, so digest words outside out are unspecified.
+ */
+template <size_t Rounds>
+struct Sha256Cone {
+	std::bitset<Rounds> a, e, w;
+	std::bitset<8> out;
+
+	size_t pruned_updates() const { return 2 * Rounds - a.count() - e.count(); }
+	size_t pruned_schedule() const { return Rounds - w.count(); }
+	size_t pruned_outputs() const { return 8 - out.count(); }
+
+	/**
+	 * Backward dependency analysis from the digest bits set in bits. Slicing
+	 * is per word: a word is computed whole if any of its bits is needed.
+	 */
+	static Sha256Cone Plan(const std::bitset<256>& bits) {
+		std::bitset<8> words;
+		for (size_t i = 0; i < 256; i++) {
+			if (bits[i]) {
+				words[i / 32] = true;
+			}
+		}
+		return PlanWords(words);
+	}
+
+	/** The whole compression. */
+	static const Sha256Cone& Full() {
+		static const Sha256Cone full = PlanWords(std::bitset<8>().set());
+		return full;
+	}
+
+	/**
+	 * Round r reads a and e of rounds r-1..r-4 (negative rounds being the
+	 * chaining input) and w[r]; w[t] for t >= 16 reads w[t-2], w[t-7],
+	 * w[t-15] and w[t-16]. After the last round, state word j < 4 is a of
+	 * round Rounds-1-j and word j >= 4 is e of round Rounds-1-(j-4).
+	 */
+	static Sha256Cone PlanWords(const std::bitset<8>& words) {
+		Sha256Cone cone;
+		cone.out = words;
+		auto need = [](std::bitset<Rounds>& set, ptrdiff_t r) {
+			if (r >= 0) {
+				set[r] = true;
+			}
+		};
+		for (size_t j = 0; j < 4; j++) {
+			if (words[j]) {
+				need(cone.a, ptrdiff_t(Rounds) - 1 - ptrdiff_t(j));
+			}
+			if (words[j + 4]) {
+				need(cone.e, ptrdiff_t(Rounds) - 1 - ptrdiff_t(j));
+			}
+		}
+
+		for (ptrdiff_t r = ptrdiff_t(Rounds) - 1; r >= 0; r--) {
+			if (!cone.a[r] && !cone.e[r]) {
+				continue;
+			}
+			for (ptrdiff_t k = 1; k <= 4; k++) {
+				need(cone.e, r - k);
+			}
+			need(cone.w, r);
+			if (cone.a[r]) {
+				for (ptrdiff_t k = 1; k <= 3; k++) {
+					need(cone.a, r - k);
+				}
+			}
+			if (cone.e[r]) {
+				need(cone.a, r - 4);
+			}
+		}
+
+		for (ptrdiff_t t = ptrdiff_t(Rounds) - 1; t >= 16; t--) {
+			if (cone.w[t]) {
+				for (ptrdiff_t k : {2, 7, 15, 16}) {
+					need(cone.w, t - k);
+				}
+			}
+		}
+		return cone;
+	}
+};
+
+/**
+ * SHA-256, or its compression function cut to the first Rounds rounds.
+ * Hook is called after every round (see round_hook.h).
+ */
+template <typename T, size_t Rounds = 64, typename Hook = NoInstrumentation>
 class Sha256 {
+	static_assert(Rounds <= 64, "SHA-256 has 64 rounds");
+
 private:
 	using word_t = Word<T, 32>;
 	using bit_t = Bit<T>;
 	template <size_t N>
-	using nested_word = NestedContainer<std::array<bit_t, N * 32>, std::array<word_t, N>>;
+	using nested_word = typename WordStorage<T, N>::type;
 
 public:
+	/** The eight chaining words. */
+	using state_t = nested_word<8>;
+	/** One 512-bit message block, as sixteen words or 512 bits. */
+	using block_t = nested_word<16>;
+
+	/**
+	 * Everything Write() has absorbed so far: the chaining state, the bits of
+	 * the unfinished block and the length. A copy can be resumed any number
+	 * of times, e.g. after the fixed first block of a header.
+	 */
+	struct Midstate {
+		state_t state;
+		block_t buf;
+		uint64_t bits;
+	};
+
+	/** Slice of the compression function; see Sha256Cone. */
+	using Cone = Sha256Cone<Rounds>;
+
 	Sha256() {
 		Reset();
 	}
+	explicit Sha256(const Midstate& m) {
+		Restore(m);
+	}
 
 	void Write(const bit_t* data, size_t len) {
 		const bit_t* end = data + len;
 		size_t bufsize = bits_ % 512;
 		if (bufsize && bufsize + len >= 512) {
 			// Fill the buffer, and process it.
-			std::copy_n(data, 512 - bufsize, buf_.as_flat().begin() + bufsize);
+			buf_.assign(bufsize, data, 512 - bufsize);
 			bits_ += 512 - bufsize;
 			data += 512 - bufsize;
-			Transform();
+			Transform(s_, buf_);
 			bufsize = 0;
 		}
 		if (end - data >= 512) {
 			size_t blocks = (end - data) / 512;
 			bits_ += 512 * blocks;
 			while (blocks--) {
-				std::copy_n(data, 512, buf_.as_flat().begin());
-				Transform();
+				buf_.assign(0, data, 512);
+				Transform(s_, buf_);
 				data += 512;
 			}
 		}
 		if (end > data) {
 			// Fill the buffer with what remains.
-			std::copy(data, end, buf_.as_flat().begin() + bufsize);
+			buf_.assign(bufsize, data, end - data);
 			bits_ += end - data;
 		}
 	}
@@ -60,24 +190,127 @@ public:
 		Write(bit_t(data));
 	}
 
-	std::array<Bit<T>, 256>& Finalize() {
-		const size_t len = bits_;
-		Bit<T> zero = Bit<T>::zero(), one = Bit<T>::one();
+	/**
+	 * Appends len bytes, most significant bit first. Whole blocks are loaded
+	 * as words straight from data into the compression function; only the
+	 * bytes of an unfinished block go through the bit buffer.
+	 */
+	void Write(const uint8_t* data, size_t len) {
+		if (bits_ % 8 != 0) {
+			for (size_t i = 0; i < len; i++) {
+				Write(unpackbits<T, uint8_t>(data[i]));
+			}
+			return;
+		}
+
+		const size_t bufbytes = bits_ % 512 / 8;
+		if (bufbytes) {
+			const size_t n = std::min(len, 64 - bufbytes);
+			for (size_t i = 0; i < n; i++) {
+				WriteByte(bufbytes + i, data[i]);
+			}
+			bits_ += 8 * n;
+			data += n;
+			len -= n;
+			if (bufbytes + n < 64) {
+				return;
+			}
+			Transform(s_, buf_);
+		}
+		for (; len >= 64; data += 64, len -= 64) {
+			for (size_t j = 0; j < 16; j++) {
+				buf_(j) = word_t(ReadBE32(data + 4 * j));
+			}
+			Transform(s_, buf_);
+			bits_ += 512;
+		}
+		for (size_t i = 0; i < len; i++) {
+			WriteByte(i, data[i]);
+		}
+		bits_ += 8 * len;
+	}
+
+	/**
+	 * Pads the message a block at a time and returns the digest. Only the
+	 * last compression is sliced to cone; after a sliced Finalize() the
+	 * object must be Reset() or Restore()d before it is written to again.
+	 */
+	decltype(auto) Finalize(const Cone& cone = Cone::Full()) {
+		const uint64_t len = bits_;
+		const size_t bufsize = bits_ % 512;
+		const bit_t zero = bit_t::zero();
+
+		// The 1 bit, then zeros to the end of the block.
+		buf_[bufsize] = bit_t::one();
+		for (size_t i = bufsize + 1; i % 32 != 0; i++) {
+			buf_[i] = zero;
+		}
+		for (size_t j = bufsize / 32 + 1; j < 16; j++) {
+			buf_(j) = word_t(0ull);
+		}
+
+		// The 64-bit length, in a block of its own if it no longer fits.
+		if (bufsize >= 448) {
+			Transform(s_, buf_);
+			for (size_t j = 0; j < 14; j++) {
+				buf_(j) = word_t(0ull);
+			}
+		}
+		buf_(14) = word_t(len >> 32);
+		buf_(15) = word_t(len & 0xffffffffu);
+		Transform(s_, buf_, cone);
+		bits_ = (len + 64 + 512) / 512 * 512;
+
+		return s_.as_flat();
+	}
 
-		Write(&one, 1);
+	/**
+	 * SHA256d: finalizes, then hashes the digest in place. The second message
+	 * is always one 256-bit block, so its padding is known and the digest
+	 * words go straight into the block buffer. With a cone, the first hash is
+	 * sliced to the digest words the second one reads.
+	 */
+	decltype(auto) FinalizeDouble(const Cone& cone = Cone::Full()) {
+		std::bitset<8> inner;
+		for (size_t j = 0; j < 8 && j < Rounds; j++) {
+			inner[j] = cone.w[j];
+		}
+		Finalize(Cone::PlanWords(inner));
 
-		while ((bits_ + 64) % 512 != 0) {
-			Write(&zero, 1);
+		for (size_t j = 0; j < 8; j++) {
+			buf_(j) = s_(j);
+		}
+		buf_(8) = word_t(0x80000000u);
+		for (size_t j = 9; j < 15; j++) {
+			buf_(j) = word_t(0ull);
 		}
+		buf_(15) = word_t(256u);
 
-		Write(unpackbits<T, uint64_t>(len));
+		s_ = InitialState();
+		Transform(s_, buf_, cone);
+		bits_ = 512;
 
 		return s_.as_flat();
 	}
 
 	void Reset() {
 		bits_ = 0;
-		s_.as_nested() = {
+		s_ = InitialState();
+	}
+
+	Midstate Save() const {
+		return {s_, buf_, bits_};
+	}
+
+	void Restore(const Midstate& m) {
+		s_ = m.state;
+		buf_ = m.buf;
+		bits_ = m.bits;
+	}
+
+	static state_t InitialState() {
+		state_t s;
+		s.as_nested() = {
 			0x6a09e667u,
 			0xbb67ae85u,
 			0x3c6ef372u,
@@ -87,6 +320,50 @@ public:
 			0x1f83d9abu,
 			0x5be0cd19u,
 		};
+		return s;
+	}
+
+	/** The SHA-256 compression function on its own: no padding, no length. */
+	static void Compress(state_t& state, const block_t& block, const Cone& cone = Cone::Full()) {
+		block_t w = block;
+		Transform(state, w, cone);
+	}
+
+	/**
+	 * One compression stopped between rounds, for runs long enough to be
+	 * checkpointed (see checkpoint.h). v holds the working variables the way
+	 * Transform() keeps them, role r before round i in v[(r - i) % 8], and w
+	 * the sixteen live schedule words.
+	 */
+	struct RoundState {
+		state_t chain;
+		std::array<Word<T, 32>, 8> v;
+		block_t w;
+		size_t round;
+	};
+
+	static RoundState Begin(const state_t& chain, const block_t& block) {
+		RoundState r{chain, {}, block, 0};
+		for (size_t j = 0; j < 8; j++) {
+			r.v[j] = chain(j);
+		}
+		return r;
+	}
+
+	/**
+	 * Runs the next round; the last one also adds the working variables into
+	 * chain, which then holds the compression's output. Returns false, doing
+	 * nothing, once all rounds are done.
+	 */
+	static bool Step(RoundState& r, const Cone& cone = Cone::Full()) {
+		if (r.round >= Rounds) {
+			return false;
+		}
+		RoundAt(r.round, r.v, r.w, cone);
+		if (++r.round == Rounds) {
+			FeedForward(r.chain, r.v, cone);
+		}
+		return true;
 	}
 
 	~Sha256() {}
@@ -99,102 +376,87 @@ private:
 	static constexpr word_t sigma0(const word_t& x) { return x.rot_r(7) ^ x.rot_r(18) ^ (x >> 3); }
 	static constexpr word_t sigma1(const word_t& x) { return x.rot_r(17) ^ x.rot_r(19) ^ (x >> 10); }
 
-	/** One round of SHA-256. */
+	static uint32_t ReadBE32(const uint8_t* p) {
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	/** Stores a byte at byte offset pos of the block buffer. */
+	void WriteByte(size_t pos, uint8_t b) {
+		for (size_t k = 0; k < 8; k++) {
+			buf_[8 * pos + k] = (b >> (7 - k)) & 1 ? bit_t::one() : bit_t::zero();
+		}
+	}
+
+	/** One round of SHA-256; update_e and update_a pick which of the two new words are computed. */
 	static void Round(const word_t& a, const word_t& b, const word_t& c, word_t& d,
-					  const word_t& e, const word_t& f, const word_t& g, word_t& h, const word_t& k) {
-		word_t t1 = h + Sigma1(e) + Ch(e, f, g) + k;
-		word_t t2 = Sigma0(a) + Maj(a, b, c);
-		d += t1;
-		h = t1 + t2;
-		std::cout << 'R';
-	}
-
-	/** Perform a number of SHA-256 transformations, processing 64-byte chunks. */
-	void Transform() {
-		word_t a = s_(0), b = s_(1), c = s_(2), d = s_(3), e = s_(4), f = s_(5), g = s_(6), h = s_(7);
-
-		Round(a, b, c, d, e, f, g, h, 0x428a2f98 + buf_(0x0));
-		Round(h, a, b, c, d, e, f, g, 0x71374491 + buf_(0x1));
-		Round(g, h, a, b, c, d, e, f, 0xb5c0fbcf + buf_(0x2));
-		Round(f, g, h, a, b, c, d, e, 0xe9b5dba5 + buf_(0x3));
-		Round(e, f, g, h, a, b, c, d, 0x3956c25b + buf_(0x4));
-		Round(d, e, f, g, h, a, b, c, 0x59f111f1 + buf_(0x5));
-		Round(c, d, e, f, g, h, a, b, 0x923f82a4 + buf_(0x6));
-		Round(b, c, d, e, f, g, h, a, 0xab1c5ed5 + buf_(0x7));
-		Round(a, b, c, d, e, f, g, h, 0xd807aa98 + buf_(0x8));
-		Round(h, a, b, c, d, e, f, g, 0x12835b01 + buf_(0x9));
-		Round(g, h, a, b, c, d, e, f, 0x243185be + buf_(0xa));
-		Round(f, g, h, a, b, c, d, e, 0x550c7dc3 + buf_(0xb));
-		Round(e, f, g, h, a, b, c, d, 0x72be5d74 + buf_(0xc));
-		Round(d, e, f, g, h, a, b, c, 0x80deb1fe + buf_(0xd));
-		Round(c, d, e, f, g, h, a, b, 0x9bdc06a7 + buf_(0xe));
-		Round(b, c, d, e, f, g, h, a, 0xc19bf174 + buf_(0xf));
-
-		Round(a, b, c, d, e, f, g, h, 0xe49b69c1 + (buf_(0x0) += sigma1(buf_(0xe)) + buf_(0x9) + sigma0(buf_(0x1))));
-		Round(h, a, b, c, d, e, f, g, 0xefbe4786 + (buf_(0x1) += sigma1(buf_(0xf)) + buf_(0xa) + sigma0(buf_(0x2))));
-		Round(g, h, a, b, c, d, e, f, 0x0fc19dc6 + (buf_(0x2) += sigma1(buf_(0x0)) + buf_(0xb) + sigma0(buf_(0x3))));
-		Round(f, g, h, a, b, c, d, e, 0x240ca1cc + (buf_(0x3) += sigma1(buf_(0x1)) + buf_(0xc) + sigma0(buf_(0x4))));
-		Round(e, f, g, h, a, b, c, d, 0x2de92c6f + (buf_(0x4) += sigma1(buf_(0x2)) + buf_(0xd) + sigma0(buf_(0x5))));
-		Round(d, e, f, g, h, a, b, c, 0x4a7484aa + (buf_(0x5) += sigma1(buf_(0x3)) + buf_(0xe) + sigma0(buf_(0x6))));
-		Round(c, d, e, f, g, h, a, b, 0x5cb0a9dc + (buf_(0x6) += sigma1(buf_(0x4)) + buf_(0xf) + sigma0(buf_(0x7))));
-		Round(b, c, d, e, f, g, h, a, 0x76f988da + (buf_(0x7) += sigma1(buf_(0x5)) + buf_(0x0) + sigma0(buf_(0x8))));
-		Round(a, b, c, d, e, f, g, h, 0x983e5152 + (buf_(0x8) += sigma1(buf_(0x6)) + buf_(0x1) + sigma0(buf_(0x9))));
-		Round(h, a, b, c, d, e, f, g, 0xa831c66d + (buf_(0x9) += sigma1(buf_(0x7)) + buf_(0x2) + sigma0(buf_(0xa))));
-		Round(g, h, a, b, c, d, e, f, 0xb00327c8 + (buf_(0xa) += sigma1(buf_(0x8)) + buf_(0x3) + sigma0(buf_(0xb))));
-		Round(f, g, h, a, b, c, d, e, 0xbf597fc7 + (buf_(0xb) += sigma1(buf_(0x9)) + buf_(0x4) + sigma0(buf_(0xc))));
-		Round(e, f, g, h, a, b, c, d, 0xc6e00bf3 + (buf_(0xc) += sigma1(buf_(0xa)) + buf_(0x5) + sigma0(buf_(0xd))));
-		Round(d, e, f, g, h, a, b, c, 0xd5a79147 + (buf_(0xd) += sigma1(buf_(0xb)) + buf_(0x6) + sigma0(buf_(0xe))));
-		Round(c, d, e, f, g, h, a, b, 0x06ca6351 + (buf_(0xe) += sigma1(buf_(0xc)) + buf_(0x7) + sigma0(buf_(0xf))));
-		Round(b, c, d, e, f, g, h, a, 0x14292967 + (buf_(0xf) += sigma1(buf_(0xd)) + buf_(0x8) + sigma0(buf_(0x0))));
-
-		Round(a, b, c, d, e, f, g, h, 0x27b70a85 + (buf_(0x0) += sigma1(buf_(0xe)) + buf_(0x9) + sigma0(buf_(0x1))));
-		Round(h, a, b, c, d, e, f, g, 0x2e1b2138 + (buf_(0x1) += sigma1(buf_(0xf)) + buf_(0xa) + sigma0(buf_(0x2))));
-		Round(g, h, a, b, c, d, e, f, 0x4d2c6dfc + (buf_(0x2) += sigma1(buf_(0x0)) + buf_(0xb) + sigma0(buf_(0x3))));
-		Round(f, g, h, a, b, c, d, e, 0x53380d13 + (buf_(0x3) += sigma1(buf_(0x1)) + buf_(0xc) + sigma0(buf_(0x4))));
-		Round(e, f, g, h, a, b, c, d, 0x650a7354 + (buf_(0x4) += sigma1(buf_(0x2)) + buf_(0xd) + sigma0(buf_(0x5))));
-		Round(d, e, f, g, h, a, b, c, 0x766a0abb + (buf_(0x5) += sigma1(buf_(0x3)) + buf_(0xe) + sigma0(buf_(0x6))));
-		Round(c, d, e, f, g, h, a, b, 0x81c2c92e + (buf_(0x6) += sigma1(buf_(0x4)) + buf_(0xf) + sigma0(buf_(0x7))));
-		Round(b, c, d, e, f, g, h, a, 0x92722c85 + (buf_(0x7) += sigma1(buf_(0x5)) + buf_(0x0) + sigma0(buf_(0x8))));
-		Round(a, b, c, d, e, f, g, h, 0xa2bfe8a1 + (buf_(0x8) += sigma1(buf_(0x6)) + buf_(0x1) + sigma0(buf_(0x9))));
-		Round(h, a, b, c, d, e, f, g, 0xa81a664b + (buf_(0x9) += sigma1(buf_(0x7)) + buf_(0x2) + sigma0(buf_(0xa))));
-		Round(g, h, a, b, c, d, e, f, 0xc24b8b70 + (buf_(0xa) += sigma1(buf_(0x8)) + buf_(0x3) + sigma0(buf_(0xb))));
-		Round(f, g, h, a, b, c, d, e, 0xc76c51a3 + (buf_(0xb) += sigma1(buf_(0x9)) + buf_(0x4) + sigma0(buf_(0xc))));
-		Round(e, f, g, h, a, b, c, d, 0xd192e819 + (buf_(0xc) += sigma1(buf_(0xa)) + buf_(0x5) + sigma0(buf_(0xd))));
-		Round(d, e, f, g, h, a, b, c, 0xd6990624 + (buf_(0xd) += sigma1(buf_(0xb)) + buf_(0x6) + sigma0(buf_(0xe))));
-		Round(c, d, e, f, g, h, a, b, 0xf40e3585 + (buf_(0xe) += sigma1(buf_(0xc)) + buf_(0x7) + sigma0(buf_(0xf))));
-		Round(b, c, d, e, f, g, h, a, 0x106aa070 + (buf_(0xf) += sigma1(buf_(0xd)) + buf_(0x8) + sigma0(buf_(0x0))));
-
-		Round(a, b, c, d, e, f, g, h, 0x19a4c116 + (buf_(0x0) += sigma1(buf_(0xe)) + buf_(0x9) + sigma0(buf_(0x1))));
-		Round(h, a, b, c, d, e, f, g, 0x1e376c08 + (buf_(0x1) += sigma1(buf_(0xf)) + buf_(0xa) + sigma0(buf_(0x2))));
-		Round(g, h, a, b, c, d, e, f, 0x2748774c + (buf_(0x2) += sigma1(buf_(0x0)) + buf_(0xb) + sigma0(buf_(0x3))));
-		Round(f, g, h, a, b, c, d, e, 0x34b0bcb5 + (buf_(0x3) += sigma1(buf_(0x1)) + buf_(0xc) + sigma0(buf_(0x4))));
-		Round(e, f, g, h, a, b, c, d, 0x391c0cb3 + (buf_(0x4) += sigma1(buf_(0x2)) + buf_(0xd) + sigma0(buf_(0x5))));
-		Round(d, e, f, g, h, a, b, c, 0x4ed8aa4a + (buf_(0x5) += sigma1(buf_(0x3)) + buf_(0xe) + sigma0(buf_(0x6))));
-		Round(c, d, e, f, g, h, a, b, 0x5b9cca4f + (buf_(0x6) += sigma1(buf_(0x4)) + buf_(0xf) + sigma0(buf_(0x7))));
-		Round(b, c, d, e, f, g, h, a, 0x682e6ff3 + (buf_(0x7) += sigma1(buf_(0x5)) + buf_(0x0) + sigma0(buf_(0x8))));
-		Round(a, b, c, d, e, f, g, h, 0x748f82ee + (buf_(0x8) += sigma1(buf_(0x6)) + buf_(0x1) + sigma0(buf_(0x9))));
-		Round(h, a, b, c, d, e, f, g, 0x78a5636f + (buf_(0x9) += sigma1(buf_(0x7)) + buf_(0x2) + sigma0(buf_(0xa))));
-		Round(g, h, a, b, c, d, e, f, 0x84c87814 + (buf_(0xa) += sigma1(buf_(0x8)) + buf_(0x3) + sigma0(buf_(0xb))));
-		Round(f, g, h, a, b, c, d, e, 0x8cc70208 + (buf_(0xb) += sigma1(buf_(0x9)) + buf_(0x4) + sigma0(buf_(0xc))));
-		Round(e, f, g, h, a, b, c, d, 0x90befffa + (buf_(0xc) += sigma1(buf_(0xa)) + buf_(0x5) + sigma0(buf_(0xd))));
-		Round(d, e, f, g, h, a, b, c, 0xa4506ceb + (buf_(0xd) += sigma1(buf_(0xb)) + buf_(0x6) + sigma0(buf_(0xe))));
-		Round(c, d, e, f, g, h, a, b, 0xbef9a3f7 + (buf_(0xe) + sigma1(buf_(0xc)) + buf_(0x7) + sigma0(buf_(0xf))));
-		Round(b, c, d, e, f, g, h, a, 0xc67178f2 + (buf_(0xf) + sigma1(buf_(0xd)) + buf_(0x8) + sigma0(buf_(0x0))));
-
-		s_(0) += a;
-		s_(1) += b;
-		s_(2) += c;
-		s_(3) += d;
-		s_(4) += e;
-		s_(5) += f;
-		s_(6) += g;
-		s_(7) += h;
+					  const word_t& e, const word_t& f, const word_t& g, word_t& h, const word_t& k, const word_t& w,
+					  bool update_e = true, bool update_a = true) {
+		word_t t1 = word_t::sum({h, Sigma1(e), Ch(e, f, g), k, w});
+		if (update_e) {
+			d += t1;
+		}
+		if (update_a) {
+			h = t1 + (Sigma0(a) + Maj(a, b, c));
+		}
+	}
+
+	static constexpr uint32_t kRoundConstants[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+
+	/**
+	 * Perform a SHA-256 transformation of one 64-byte chunk, cut to Rounds
+	 * rounds; w is overwritten by the message schedule. Instead of renaming
+	 * a..h every round, round i reads the role r variable from v[(r - i) % 8].
+	 * Words outside cone are skipped; a skipped schedule word leaves its
+	 * slot holding w[i - 16], which nothing in the cone reads again.
+	 */
+	static void Transform(state_t& s, block_t& w, const Cone& cone = Cone::Full()) {
+		std::array<word_t, 8> v;
+		for (size_t j = 0; j < 8; j++) {
+			v[j] = s(j);
+		}
+
+		for (size_t i = 0; i < Rounds; i++) {
+			RoundAt(i, v, w, cone);
+		}
+
+		FeedForward(s, v, cone);
+	}
+
+	/** Round i on the rotating working variables, schedule word included. */
+	static void RoundAt(size_t i, std::array<word_t, 8>& v, block_t& w, const Cone& cone) {
+		if (i >= 16 && cone.w[i]) {
+			w(i % 16) = word_t::sum({w(i % 16), sigma1(w((i + 14) % 16)), w((i + 9) % 16), sigma0(w((i + 1) % 16))});
+		}
+		if (!cone.a[i] && !cone.e[i]) {
+			return;
+		}
+		Round(v[(0 - i) & 7], v[(1 - i) & 7], v[(2 - i) & 7], v[(3 - i) & 7],
+			  v[(4 - i) & 7], v[(5 - i) & 7], v[(6 - i) & 7], v[(7 - i) & 7], kRoundConstants[i], w(i % 16),
+			  cone.e[i], cone.a[i]);
+		Hook::round(i, {&v[(7 - i) & 7], &v[(0 - i) & 7], &v[(1 - i) & 7], &v[(2 - i) & 7], &v[(3 - i) & 7], &v[(4 - i) & 7], &v[(5 - i) & 7], &v[(6 - i) & 7]}, w(i % 16));
+	}
+
+	static void FeedForward(state_t& s, const std::array<word_t, 8>& v, const Cone& cone) {
+		for (size_t j = 0; j < 8; j++) {
+			if (cone.out[j]) {
+				s(j) += v[(j - Rounds) & 7];
+			}
+		}
 	}
 
 private:
 	uint64_t bits_;
-	nested_word<16> buf_;
-	nested_word<8> s_;
+	block_t buf_;
+	state_t s_;
 };
 
 #endif  // !DESHA256_SHA256_H_
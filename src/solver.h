@@ -0,0 +1,744 @@
+#ifndef DESHA256_SOLVER_H_
+#define DESHA256_SOLVER_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include "tseitin.h"
+
+/**
+ * Incremental CDCL solver: two watched literals with blockers, VSIDS, first-UIP
+ * learning with recursive minimization, Luby restarts, activity-based learnt
+ * clause deletion and solving under assumptions.
+ *
+ * It is a ClauseSink, so a CnfEncoder can encode Sha256<CnfLit> straight into
+ * it; literals are CnfLit, with variable 0 fixed to false so the encoder's
+ * constant literals need no special casing.
+ */
+class Solver : public ClauseSink {
+public:
+	enum class Result { sat, unsat, unknown };
+
+	Solver() {
+		new_var();
+		enqueue(CnfLit::one(), kNoReason);
+	}
+
+	Solver(const Solver&) = delete;
+	Solver& operator=(const Solver&) = delete;
+
+	uint32_t new_var() {
+		const uint32_t v = static_cast<uint32_t>(assigns_.size());
+		assigns_.push_back(kUndef);
+		level_.push_back(0);
+		reason_.push_back(kNoReason);
+		activity_.push_back(0.0);
+		polarity_.push_back(1);
+		seen_.push_back(0);
+		heap_index_.push_back(-1);
+		watches_.emplace_back();
+		watches_.emplace_back();
+		heap_insert(v);
+		return v;
+	}
+
+	size_t num_vars() const { return assigns_.size() - 1; }
+	size_t num_clauses() const { return clauses_.size(); }
+	size_t num_learnts() const { return learnts_.size(); }
+
+	uint64_t conflicts() const { return conflicts_; }
+	uint64_t decisions() const { return decisions_; }
+	uint64_t propagations() const { return propagations_; }
+
+	/** Stops solve() with Result::unknown after this many conflicts; negative means no limit. */
+	void set_conflict_budget(int64_t budget) { conflict_budget_ = budget; }
+
+	void add_clause(const int* lits, size_t n) override {
+		std::vector<CnfLit> ps;
+		ps.reserve(n);
+		for (size_t i = 0; i < n; i++) {
+			const uint32_t v = static_cast<uint32_t>(std::abs(lits[i]));
+			while (v >= assigns_.size()) {
+				new_var();
+			}
+			ps.emplace_back(v, lits[i] < 0);
+		}
+		add_clause(ps);
+	}
+
+	/** Adds a permanent clause; returns false once the clause database is unsatisfiable. */
+	bool add_clause(std::vector<CnfLit> ps) {
+		if (!ok_) {
+			return false;
+		}
+		assert(trail_lim_.empty());
+
+		std::sort(ps.begin(), ps.end(), [](CnfLit a, CnfLit b) { return a.raw() < b.raw(); });
+		size_t j = 0;
+		for (size_t i = 0; i < ps.size(); i++) {
+			const CnfLit p = ps[i];
+			if (value(p) == kTrue || (j > 0 && ps[j - 1] == ~p)) {
+				return true;
+			}
+			if (value(p) != kFalse && (j == 0 || ps[j - 1] != p)) {
+				ps[j++] = p;
+			}
+		}
+		ps.resize(j);
+
+		if (ps.empty()) {
+			return ok_ = false;
+		}
+		if (ps.size() == 1) {
+			enqueue(ps[0], kNoReason);
+			return ok_ = (propagate() == kNoReason);
+		}
+
+		const uint32_t cref = alloc(ps, false);
+		clauses_.push_back(cref);
+		attach(cref);
+		return true;
+	}
+
+	/** Solves under the given assumptions; the clause database is kept for later calls. */
+	Result solve(const std::vector<CnfLit>& assumptions = {}) {
+		model_.clear();
+		conflict_.clear();
+		if (!ok_) {
+			return Result::unsat;
+		}
+
+		assumptions_ = assumptions;
+		max_learnts_ = std::max<double>(clauses_.size() / 3.0, 5000.0);
+		const uint64_t start = conflicts_;
+
+		Result status = Result::unknown;
+		for (int restarts = 0; status == Result::unknown; restarts++) {
+			status = search(static_cast<int64_t>(luby(2.0, restarts) * 100));
+			if (status == Result::unknown && conflict_budget_ >= 0 && conflicts_ - start >= static_cast<uint64_t>(conflict_budget_)) {
+				break;
+			}
+		}
+
+		if (status == Result::sat) {
+			model_ = assigns_;
+		} else if (status == Result::unsat && conflict_.empty()) {
+			ok_ = false;
+		}
+		cancel_until(0);
+		return status;
+	}
+
+	/** Value of a literal in the last satisfying assignment. */
+	bool model_value(CnfLit p) const {
+		assert(p.var() < model_.size());
+		return (model_[p.var()] ^ static_cast<uint8_t>(p.negated())) == kTrue;
+	}
+
+	/** After an unsat answer under assumptions: the assumptions that took part in the refutation. */
+	const std::vector<CnfLit>& conflict() const { return conflict_; }
+
+	~Solver() {}
+
+private:
+	static constexpr uint8_t kFalse = 0;
+	static constexpr uint8_t kTrue = 1;
+	static constexpr uint8_t kUndef = 2;
+	static constexpr uint32_t kNoReason = ~uint32_t(0);
+
+	/** For binary clauses the blocker is the other literal, so the arena is only touched on propagation. */
+	struct Watcher {
+		uint32_t cref;
+		CnfLit blocker;
+		bool binary;
+	};
+
+	uint8_t value(CnfLit p) const {
+		const uint8_t a = assigns_[p.var()];
+		return a == kUndef ? kUndef : a ^ static_cast<uint8_t>(p.negated());
+	}
+
+	int decision_level() const { return static_cast<int>(trail_lim_.size()); }
+
+	/*
+	 * Clause arena layout: header (size << 2 | learnt << 1 | deleted),
+	 * activity as float bits, then the literals.
+	 */
+	uint32_t clause_size(uint32_t cref) const { return arena_[cref] >> 2; }
+	bool learnt(uint32_t cref) const { return arena_[cref] & 2; }
+	bool deleted(uint32_t cref) const { return arena_[cref] & 1; }
+	CnfLit* lits(uint32_t cref) { return reinterpret_cast<CnfLit*>(&arena_[cref + 2]); }
+	float clause_activity(uint32_t cref) const {
+		float a;
+		std::memcpy(&a, &arena_[cref + 1], sizeof(a));
+		return a;
+	}
+	void set_clause_activity(uint32_t cref, float a) { std::memcpy(&arena_[cref + 1], &a, sizeof(a)); }
+
+	uint32_t alloc(const std::vector<CnfLit>& ps, bool is_learnt) {
+		const uint32_t cref = static_cast<uint32_t>(arena_.size());
+		arena_.push_back(static_cast<uint32_t>(ps.size() << 2) | (is_learnt ? 2 : 0));
+		arena_.push_back(0);
+		for (const CnfLit& p : ps) {
+			arena_.push_back(p.raw());
+		}
+		return cref;
+	}
+
+	void attach(uint32_t cref) {
+		const CnfLit* c = lits(cref);
+		const bool binary = clause_size(cref) == 2;
+		watches_[c[0].raw()].push_back({cref, c[1], binary});
+		watches_[c[1].raw()].push_back({cref, c[0], binary});
+	}
+
+	bool locked(uint32_t cref) {
+		const CnfLit p = lits(cref)[0];
+		return value(p) == kTrue && reason_[p.var()] == cref;
+	}
+
+	void enqueue(CnfLit p, uint32_t from) {
+		const uint32_t v = p.var();
+		assigns_[v] = p.negated() ? kFalse : kTrue;
+		level_[v] = decision_level();
+		reason_[v] = from;
+		trail_.push_back(p);
+	}
+
+	/** Returns the conflicting clause, or kNoReason. */
+	uint32_t propagate() {
+		uint32_t confl = kNoReason;
+
+		while (qhead_ < trail_.size()) {
+			const CnfLit false_lit = ~trail_[qhead_++];
+			std::vector<Watcher>& ws = watches_[false_lit.raw()];
+			propagations_++;
+
+			size_t i = 0, j = 0;
+			while (i < ws.size()) {
+				const Watcher w = ws[i];
+				if (value(w.blocker) == kTrue) {
+					ws[j++] = ws[i++];
+					continue;
+				}
+
+				if (w.binary) {
+					ws[j++] = ws[i++];
+					if (value(w.blocker) == kFalse) {
+						confl = w.cref;
+						qhead_ = trail_.size();
+						while (i < ws.size()) {
+							ws[j++] = ws[i++];
+						}
+					} else {
+						CnfLit* c = lits(w.cref);
+						if (c[0] != w.blocker) {
+							std::swap(c[0], c[1]);
+						}
+						enqueue(w.blocker, w.cref);
+					}
+					continue;
+				}
+
+				CnfLit* c = lits(w.cref);
+				if (c[0] == false_lit) {
+					std::swap(c[0], c[1]);
+				}
+				i++;
+
+				const CnfLit first = c[0];
+				const Watcher nw = {w.cref, first, false};
+				if (first != w.blocker && value(first) == kTrue) {
+					ws[j++] = nw;
+					continue;
+				}
+
+				const uint32_t n = clause_size(w.cref);
+				bool moved = false;
+				for (uint32_t k = 2; k < n; k++) {
+					if (value(c[k]) != kFalse) {
+						c[1] = c[k];
+						c[k] = false_lit;
+						watches_[c[1].raw()].push_back(nw);
+						moved = true;
+						break;
+					}
+				}
+				if (moved) {
+					continue;
+				}
+
+				ws[j++] = nw;
+				if (value(first) == kFalse) {
+					confl = w.cref;
+					qhead_ = trail_.size();
+					while (i < ws.size()) {
+						ws[j++] = ws[i++];
+					}
+				} else {
+					enqueue(first, w.cref);
+				}
+			}
+			ws.resize(j);
+		}
+
+		return confl;
+	}
+
+	void analyze(uint32_t confl, std::vector<CnfLit>& out_learnt, int& out_btlevel) {
+		int path = 0;
+		bool first = true;
+		CnfLit p;
+		size_t index = trail_.size();
+
+		out_learnt.clear();
+		out_learnt.emplace_back();
+
+		do {
+			if (learnt(confl)) {
+				bump_clause(confl);
+			}
+			const CnfLit* c = lits(confl);
+			const uint32_t n = clause_size(confl);
+			for (uint32_t k = first ? 0 : 1; k < n; k++) {
+				const CnfLit q = c[k];
+				const uint32_t v = q.var();
+				if (!seen_[v] && level_[v] > 0) {
+					bump_var(v);
+					seen_[v] = 1;
+					if (level_[v] >= decision_level()) {
+						path++;
+					} else {
+						out_learnt.push_back(q);
+					}
+				}
+			}
+			first = false;
+
+			while (!seen_[trail_[--index].var()]) {
+			}
+			p = trail_[index];
+			confl = reason_[p.var()];
+			seen_[p.var()] = 0;
+			path--;
+		} while (path > 0);
+		out_learnt[0] = ~p;
+
+		// Recursive minimization.
+		to_clear_ = out_learnt;
+		uint32_t abstract = 0;
+		for (size_t i = 1; i < out_learnt.size(); i++) {
+			abstract |= abstract_level(out_learnt[i].var());
+		}
+		size_t j = 1;
+		for (size_t i = 1; i < out_learnt.size(); i++) {
+			const uint32_t v = out_learnt[i].var();
+			if (reason_[v] == kNoReason || !redundant(out_learnt[i], abstract)) {
+				out_learnt[j++] = out_learnt[i];
+			}
+		}
+		out_learnt.resize(j);
+
+		if (out_learnt.size() == 1) {
+			out_btlevel = 0;
+		} else {
+			size_t max_i = 1;
+			for (size_t i = 2; i < out_learnt.size(); i++) {
+				if (level_[out_learnt[i].var()] > level_[out_learnt[max_i].var()]) {
+					max_i = i;
+				}
+			}
+			std::swap(out_learnt[1], out_learnt[max_i]);
+			out_btlevel = level_[out_learnt[1].var()];
+		}
+
+		for (const CnfLit& q : to_clear_) {
+			seen_[q.var()] = 0;
+		}
+	}
+
+	uint32_t abstract_level(uint32_t v) const {
+		return uint32_t(1) << (level_[v] & 31);
+	}
+
+	bool redundant(CnfLit p, uint32_t abstract) {
+		stack_.clear();
+		stack_.push_back(p);
+		const size_t top = to_clear_.size();
+
+		while (!stack_.empty()) {
+			const uint32_t cref = reason_[stack_.back().var()];
+			stack_.pop_back();
+			const CnfLit* c = lits(cref);
+			const uint32_t n = clause_size(cref);
+			for (uint32_t k = 1; k < n; k++) {
+				const CnfLit q = c[k];
+				const uint32_t v = q.var();
+				if (seen_[v] || level_[v] == 0) {
+					continue;
+				}
+				if (reason_[v] != kNoReason && (abstract_level(v) & abstract)) {
+					seen_[v] = 1;
+					stack_.push_back(q);
+					to_clear_.push_back(q);
+				} else {
+					for (size_t i = top; i < to_clear_.size(); i++) {
+						seen_[to_clear_[i].var()] = 0;
+					}
+					to_clear_.resize(top);
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	/** Collects the assumptions that imply ~p into conflict_ (p itself included). */
+	void analyze_final(CnfLit p) {
+		conflict_.clear();
+		conflict_.push_back(p);
+		if (level_[p.var()] > 0) {
+			seen_[p.var()] = 1;
+		}
+		collect_assumptions();
+	}
+
+	/** Collects the assumptions that falsify clause confl into conflict_. */
+	void analyze_final(uint32_t confl) {
+		conflict_.clear();
+		const CnfLit* c = lits(confl);
+		const uint32_t n = clause_size(confl);
+		for (uint32_t k = 0; k < n; k++) {
+			if (level_[c[k].var()] > 0) {
+				seen_[c[k].var()] = 1;
+			}
+		}
+		collect_assumptions();
+	}
+
+	void collect_assumptions() {
+		if (trail_lim_.empty()) {
+			return;
+		}
+		for (size_t i = trail_.size(); i-- > trail_lim_[0];) {
+			const uint32_t v = trail_[i].var();
+			if (!seen_[v]) {
+				continue;
+			}
+			if (reason_[v] == kNoReason) {
+				conflict_.push_back(trail_[i]);
+			} else {
+				const CnfLit* c = lits(reason_[v]);
+				const uint32_t n = clause_size(reason_[v]);
+				for (uint32_t k = 1; k < n; k++) {
+					if (level_[c[k].var()] > 0) {
+						seen_[c[k].var()] = 1;
+					}
+				}
+			}
+			seen_[v] = 0;
+		}
+	}
+
+	void cancel_until(int level) {
+		if (decision_level() <= level) {
+			return;
+		}
+		for (size_t i = trail_.size(); i-- > trail_lim_[level];) {
+			const uint32_t v = trail_[i].var();
+			assigns_[v] = kUndef;
+			reason_[v] = kNoReason;
+			polarity_[v] = trail_[i].negated();
+			if (heap_index_[v] < 0) {
+				heap_insert(v);
+			}
+		}
+		qhead_ = trail_lim_[level];
+		trail_.resize(trail_lim_[level]);
+		trail_lim_.resize(level);
+	}
+
+	Result search(int64_t nof_conflicts) {
+		std::vector<CnfLit> learnt_clause;
+		int64_t local_conflicts = 0;
+
+		for (;;) {
+			const uint32_t confl = propagate();
+			if (confl != kNoReason) {
+				conflicts_++;
+				local_conflicts++;
+				if (decision_level() == 0) {
+					return Result::unsat;
+				}
+				if (decision_level() == 1 && !assumptions_.empty()) {
+					analyze_final(confl);
+					return Result::unsat;
+				}
+
+				int btlevel;
+				analyze(confl, learnt_clause, btlevel);
+				cancel_until(btlevel);
+
+				if (learnt_clause.size() == 1) {
+					enqueue(learnt_clause[0], kNoReason);
+				} else {
+					const uint32_t cref = alloc(learnt_clause, true);
+					learnts_.push_back(cref);
+					attach(cref);
+					bump_clause(cref);
+					enqueue(learnt_clause[0], cref);
+				}
+
+				var_inc_ /= kVarDecay;
+				cla_inc_ /= kClauseDecay;
+				continue;
+			}
+
+			if (nof_conflicts >= 0 && local_conflicts >= nof_conflicts) {
+				cancel_until(0);
+				return Result::unknown;
+			}
+
+			if (learnts_.size() >= max_learnts_ + trail_.size()) {
+				reduce_db();
+				max_learnts_ *= 1.1;
+			}
+
+			// All assumptions share decision level 1, so backjumps never replay them one by one.
+			if (decision_level() == 0 && !assumptions_.empty()) {
+				trail_lim_.push_back(trail_.size());
+				for (const CnfLit& p : assumptions_) {
+					if (value(p) == kFalse) {
+						analyze_final(p);
+						return Result::unsat;
+					}
+					if (value(p) == kUndef) {
+						enqueue(p, kNoReason);
+					}
+				}
+				continue;
+			}
+
+			CnfLit next;
+			decisions_++;
+			if (!pick_branch(next)) {
+				return Result::sat;
+			}
+
+			trail_lim_.push_back(trail_.size());
+			enqueue(next, kNoReason);
+		}
+	}
+
+	bool pick_branch(CnfLit& next) {
+		while (!heap_.empty()) {
+			const uint32_t v = heap_remove_max();
+			if (assigns_[v] == kUndef) {
+				next = CnfLit(v, polarity_[v]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void reduce_db() {
+		std::sort(learnts_.begin(), learnts_.end(), [this](uint32_t a, uint32_t b) {
+			const bool a_binary = clause_size(a) == 2, b_binary = clause_size(b) == 2;
+			if (a_binary != b_binary) {
+				return b_binary;
+			}
+			return clause_activity(a) < clause_activity(b);
+		});
+
+		size_t j = 0;
+		for (size_t i = 0; i < learnts_.size(); i++) {
+			const uint32_t cref = learnts_[i];
+			if (i < learnts_.size() / 2 && clause_size(cref) > 2 && !locked(cref)) {
+				arena_[cref] |= 1;
+			} else {
+				learnts_[j++] = cref;
+			}
+		}
+		learnts_.resize(j);
+
+		compact();
+	}
+
+	/** Drops deleted clauses from the arena and rebuilds the watch lists. */
+	void compact() {
+		std::vector<uint32_t> arena;
+		std::unordered_map<uint32_t, uint32_t> moved;
+		arena.reserve(arena_.size());
+
+		auto relocate = [&](std::vector<uint32_t>& crefs) {
+			for (uint32_t& cref : crefs) {
+				const uint32_t to = static_cast<uint32_t>(arena.size());
+				arena.insert(arena.end(), arena_.begin() + cref, arena_.begin() + cref + 2 + clause_size(cref));
+				moved.emplace(cref, to);
+				cref = to;
+			}
+		};
+		relocate(clauses_);
+		relocate(learnts_);
+
+		for (const CnfLit& p : trail_) {
+			uint32_t& r = reason_[p.var()];
+			if (r != kNoReason) {
+				r = moved.at(r);
+			}
+		}
+
+		arena_.swap(arena);
+		for (std::vector<Watcher>& ws : watches_) {
+			ws.clear();
+		}
+		for (uint32_t cref : clauses_) {
+			attach(cref);
+		}
+		for (uint32_t cref : learnts_) {
+			attach(cref);
+		}
+	}
+
+	void bump_var(uint32_t v) {
+		if ((activity_[v] += var_inc_) > 1e100) {
+			for (double& a : activity_) {
+				a *= 1e-100;
+			}
+			var_inc_ *= 1e-100;
+		}
+		if (heap_index_[v] >= 0) {
+			heap_up(heap_index_[v]);
+		}
+	}
+
+	void bump_clause(uint32_t cref) {
+		set_clause_activity(cref, clause_activity(cref) + static_cast<float>(cla_inc_));
+		if (clause_activity(cref) > 1e20f) {
+			for (uint32_t c : learnts_) {
+				set_clause_activity(c, clause_activity(c) * 1e-20f);
+			}
+			cla_inc_ *= 1e-20;
+		}
+	}
+
+	/** Luby sequence term x scaled by base y. */
+	static double luby(double y, int x) {
+		int size = 1, seq = 0;
+		while (size < x + 1) {
+			seq++;
+			size = 2 * size + 1;
+		}
+		while (size - 1 != x) {
+			size = (size - 1) >> 1;
+			seq--;
+			x = x % size;
+		}
+		return std::pow(y, seq);
+	}
+
+	/* Binary max-heap of unassigned variables ordered by activity. */
+	void heap_insert(uint32_t v) {
+		heap_index_[v] = static_cast<int>(heap_.size());
+		heap_.push_back(v);
+		heap_up(heap_index_[v]);
+	}
+
+	uint32_t heap_remove_max() {
+		const uint32_t v = heap_[0];
+		heap_[0] = heap_.back();
+		heap_index_[heap_[0]] = 0;
+		heap_index_[v] = -1;
+		heap_.pop_back();
+		if (!heap_.empty()) {
+			heap_down(0);
+		}
+		return v;
+	}
+
+	void heap_up(int i) {
+		const uint32_t v = heap_[i];
+		while (i > 0) {
+			const int parent = (i - 1) >> 1;
+			if (activity_[heap_[parent]] >= activity_[v]) {
+				break;
+			}
+			heap_[i] = heap_[parent];
+			heap_index_[heap_[i]] = i;
+			i = parent;
+		}
+		heap_[i] = v;
+		heap_index_[v] = i;
+	}
+
+	void heap_down(int i) {
+		const uint32_t v = heap_[i];
+		const int n = static_cast<int>(heap_.size());
+		for (;;) {
+			int child = 2 * i + 1;
+			if (child >= n) {
+				break;
+			}
+			if (child + 1 < n && activity_[heap_[child + 1]] > activity_[heap_[child]]) {
+				child++;
+			}
+			if (activity_[heap_[child]] <= activity_[v]) {
+				break;
+			}
+			heap_[i] = heap_[child];
+			heap_index_[heap_[i]] = i;
+			i = child;
+		}
+		heap_[i] = v;
+		heap_index_[v] = i;
+	}
+
+private:
+	static constexpr double kVarDecay = 0.95;
+	static constexpr double kClauseDecay = 0.999;
+
+	bool ok_ = true;
+
+	std::vector<uint8_t> assigns_;
+	std::vector<int> level_;
+	std::vector<uint32_t> reason_;
+	std::vector<double> activity_;
+	std::vector<uint8_t> polarity_;
+	std::vector<uint8_t> seen_;
+	std::vector<int> heap_index_;
+	std::vector<uint32_t> heap_;
+	std::vector<std::vector<Watcher>> watches_;
+
+	std::vector<uint32_t> arena_;
+	std::vector<uint32_t> clauses_;
+	std::vector<uint32_t> learnts_;
+
+	std::vector<CnfLit> trail_;
+	std::vector<size_t> trail_lim_;
+	size_t qhead_ = 0;
+
+	std::vector<CnfLit> assumptions_;
+	std::vector<CnfLit> conflict_;
+	std::vector<uint8_t> model_;
+
+	std::vector<CnfLit> to_clear_;
+	std::vector<CnfLit> stack_;
+
+	double var_inc_ = 1.0;
+	double cla_inc_ = 1.0;
+	double max_learnts_ = 0.0;
+	int64_t conflict_budget_ = -1;
+
+	uint64_t conflicts_ = 0;
+	uint64_t decisions_ = 0;
+	uint64_t propagations_ = 0;
+};
+
+#endif  // !DESHA256_SOLVER_H_
@@ -0,0 +1,387 @@
+#ifndef DESHA256_SPARSE_CLAUSE_H_
+#define DESHA256_SPARSE_CLAUSE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/** Index of the lowest set bit; x must not be 0. */
+inline unsigned lowest_bit64(uint64_t x) {
+#if defined(__GNUC__)
+	return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return static_cast<unsigned>(i);
+#else
+	unsigned i = 0;
+	for (; !(x & 1); x >>= 1) {
+		i++;
+	}
+	return i;
+#endif
+}
+
+/** Number of set bits. */
+inline unsigned popcount64(uint64_t x) {
+#if defined(__GNUC__)
+	return static_cast<unsigned>(__builtin_popcountll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<unsigned>(__popcnt64(x));
+#else
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return static_cast<unsigned>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/**
+ * Drop-in alternative to Clause<N> for large N. Literals are numbered like
+ * Clause::for_each_literal() (2 * i for x_i, 2 * i + 1 for ~x_i) and kept as a
+ * sorted array, inline for up to kInline literals and on the heap beyond.
+ * Past kDenseLimit literals the array would outgrow a bitmap of all 2 * N
+ * literals, so the clause switches to that bitmap instead.
+ *
+ * The representation is a function of size(), and x.includes(y) needs
+ * y.size() <= x.size(), so only the sparse/sparse, dense/sparse and
+ * dense/dense cases ever meet; all of them run in time linear in the
+ * literals (or words) involved.
+ */
+template <size_t N>
+class SparseClause {
+private:
+	using clause_t = SparseClause<N>;
+
+	static constexpr size_t kInline = 6;
+	static constexpr size_t kWords = (2 * N + 63) / 64;
+	static constexpr size_t kDenseLimit = std::max(kInline, 2 * N / 32);
+	static constexpr uint64_t kEven = 0x5555555555555555ull;
+
+public:
+	SparseClause() : size_(0) {}
+	SparseClause(size_t i) : size_(1) {
+		u_.inline_lits[0] = static_cast<uint32_t>(2 * i);
+	}
+
+	/** The clause of n literals, given in increasing order. */
+	static clause_t from_literals(const uint32_t* lits, size_t n) {
+		return from_sorted(lits, n);
+	}
+
+	SparseClause(const clause_t& other) : size_(0) {
+		copy_from(other);
+	}
+	SparseClause(clause_t&& other) noexcept : size_(other.size_) {
+		std::memcpy(&u_, &other.u_, sizeof(u_));
+		other.size_ = 0;
+	}
+
+	clause_t& operator=(const clause_t& other) {
+		if (this != &other) {
+			release();
+			copy_from(other);
+		}
+		return *this;
+	}
+	clause_t& operator=(clause_t&& other) noexcept {
+		if (this != &other) {
+			release();
+			size_ = other.size_;
+			std::memcpy(&u_, &other.u_, sizeof(u_));
+			other.size_ = 0;
+		}
+		return *this;
+	}
+
+	bool valid() const {
+		if (dense()) {
+			for (size_t w = 0; w < kWords; w++) {
+				if (u_.words[w] & (u_.words[w] >> 1) & kEven) {
+					return false;
+				}
+			}
+			return true;
+		}
+		const uint32_t* l = lits();
+		for (size_t k = 1; k < size_; k++) {
+			if ((l[k] ^ l[k - 1]) == 1) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Whether some variable occurs positively in one clause and negatively in the other. */
+	bool clashes(const clause_t& other) const {
+		if (dense() || other.dense()) {
+			const clause_t& d = dense() ? *this : other;
+			const clause_t& x = dense() ? other : *this;
+			if (x.dense()) {
+				for (size_t w = 0; w < kWords; w++) {
+					const uint64_t a = d.u_.words[w], b = x.u_.words[w];
+					if ((((a & kEven) << 1) & b) | (((a >> 1) & kEven) & b)) {
+						return true;
+					}
+				}
+				return false;
+			}
+			const uint32_t* xl = x.lits();
+			for (size_t k = 0; k < x.size_; k++) {
+				if (d.test(xl[k] ^ 1)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		const uint32_t *i = lits(), *i_end = i + size_;
+		const uint32_t *j = other.lits(), *j_end = j + other.size_;
+		while (i != i_end && j != j_end) {
+			if ((*i >> 1) < (*j >> 1)) {
+				++i;
+			} else if ((*j >> 1) < (*i >> 1)) {
+				++j;
+			} else if (*i != *j) {
+				return true;
+			} else {
+				++i, ++j;
+			}
+		}
+		return false;
+	}
+
+	bool includes(const clause_t& x) const {
+		if (x.size_ > size_) {
+			return false;
+		}
+		if (dense()) {
+			if (x.dense()) {
+				for (size_t w = 0; w < kWords; w++) {
+					if (x.u_.words[w] & ~u_.words[w]) {
+						return false;
+					}
+				}
+				return true;
+			}
+			const uint32_t* xl = x.lits();
+			for (size_t k = 0; k < x.size_; k++) {
+				if (!test(xl[k])) {
+					return false;
+				}
+			}
+			return true;
+		}
+		return std::includes(lits(), lits() + size_, x.lits(), x.lits() + x.size_);
+	}
+
+	/** Number of literals. */
+	size_t size() const {
+		return size_;
+	}
+
+	/** Calls fn(2 * i) for every literal x_i and fn(2 * i + 1) for every ~x_i, in increasing order. */
+	template <typename Fn>
+	void for_each_literal(Fn fn) const {
+		if (dense()) {
+			for (size_t w = 0; w < kWords; w++) {
+				for (uint64_t bits = u_.words[w]; bits; bits &= bits - 1) {
+					fn(64 * w + lowest_bit64(bits));
+				}
+			}
+			return;
+		}
+		const uint32_t* l = lits();
+		for (size_t k = 0; k < size_; k++) {
+			fn(static_cast<size_t>(l[k]));
+		}
+	}
+
+	/** One bit per literal hash; a.includes(b) implies b's signature is a subset of a's. */
+	uint64_t signature() const {
+		uint64_t sig = 0;
+		for_each_literal([&sig](size_t lit) {
+			sig |= literal_signature(lit);
+		});
+		return sig;
+	}
+
+	static uint64_t literal_signature(size_t lit) {
+		return uint64_t(1) << ((static_cast<uint32_t>(lit) * 0x9e3779b1u) >> 26);
+	}
+
+	bool operator==(const clause_t& other) const {
+		if (size_ != other.size_) {
+			return false;
+		}
+		if (dense()) {
+			return std::equal(u_.words, u_.words + kWords, other.u_.words);
+		}
+		return std::equal(lits(), lits() + size_, other.lits());
+	}
+
+	clause_t operator|(const clause_t& other) const {
+		if (dense() || other.dense()) {
+			uint64_t* words = new uint64_t[kWords]();
+			or_into(words, *this);
+			or_into(words, other);
+			return from_words(words);
+		}
+
+		uint32_t buf[2 * kDenseLimit];
+		const size_t n = std::set_union(lits(), lits() + size_, other.lits(), other.lits() + other.size_, buf) - buf;
+		return from_sorted(buf, n);
+	}
+
+	std::optional<bool> operator[](size_t i) const {
+		if (test(static_cast<uint32_t>(2 * i))) {
+			return true;
+		}
+		if (test(static_cast<uint32_t>(2 * i + 1))) {
+			return false;
+		}
+		return std::nullopt;
+	}
+
+	clause_t flip() const {
+		if (dense()) {
+			uint64_t* words = new uint64_t[kWords];
+			for (size_t w = 0; w < kWords; w++) {
+				words[w] = ((u_.words[w] & kEven) << 1) | ((u_.words[w] >> 1) & kEven);
+			}
+			return from_words(words);
+		}
+
+		clause_t r;
+		uint32_t* out = r.allocate(size_);
+		const uint32_t* l = lits();
+		for (size_t k = 0; k < size_; k++) {
+			out[k] = l[k] ^ 1;
+		}
+		// Only x_i and ~x_i, which are adjacent, can change order.
+		for (size_t k = 1; k < size_; k++) {
+			if (out[k] < out[k - 1]) {
+				std::swap(out[k], out[k - 1]);
+			}
+		}
+		return r;
+	}
+
+	~SparseClause() {
+		release();
+	}
+
+private:
+	bool dense() const { return size_ > kDenseLimit; }
+	bool on_heap() const { return size_ > kInline; }
+
+	const uint32_t* lits() const { return on_heap() ? u_.heap : u_.inline_lits; }
+
+	bool test(uint32_t lit) const {
+		if (lit >= 2 * N) {
+			return false;
+		}
+		if (dense()) {
+			return (u_.words[lit / 64] >> (lit % 64)) & 1;
+		}
+		return std::binary_search(lits(), lits() + size_, lit);
+	}
+
+	/** Sets the size and returns storage for that many sorted literals. */
+	uint32_t* allocate(size_t n) {
+		size_ = static_cast<uint32_t>(n);
+		if (on_heap()) {
+			u_.heap = new uint32_t[n];
+			return u_.heap;
+		}
+		return u_.inline_lits;
+	}
+
+	void release() {
+		if (dense()) {
+			delete[] u_.words;
+		} else if (on_heap()) {
+			delete[] u_.heap;
+		}
+		size_ = 0;
+	}
+
+	void copy_from(const clause_t& other) {
+		if (other.dense()) {
+			size_ = other.size_;
+			u_.words = new uint64_t[kWords];
+			std::copy(other.u_.words, other.u_.words + kWords, u_.words);
+			return;
+		}
+		std::copy(other.lits(), other.lits() + other.size_, allocate(other.size_));
+	}
+
+	static void or_into(uint64_t* words, const clause_t& x) {
+		if (x.dense()) {
+			for (size_t w = 0; w < kWords; w++) {
+				words[w] |= x.u_.words[w];
+			}
+			return;
+		}
+		const uint32_t* l = x.lits();
+		for (size_t k = 0; k < x.size_; k++) {
+			words[l[k] / 64] |= uint64_t(1) << (l[k] % 64);
+		}
+	}
+
+	/** Takes ownership of a bitmap, keeping it only if the literal count calls for it. */
+	static clause_t from_words(uint64_t* words) {
+		size_t n = 0;
+		for (size_t w = 0; w < kWords; w++) {
+			n += popcount64(words[w]);
+		}
+
+		clause_t r;
+		if (n > kDenseLimit) {
+			r.size_ = static_cast<uint32_t>(n);
+			r.u_.words = words;
+			return r;
+		}
+
+		uint32_t* out = r.allocate(n);
+		for (size_t w = 0; w < kWords; w++) {
+			for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+				*out++ = static_cast<uint32_t>(64 * w + lowest_bit64(bits));
+			}
+		}
+		delete[] words;
+		return r;
+	}
+
+	static clause_t from_sorted(const uint32_t* l, size_t n) {
+		if (n > kDenseLimit) {
+			uint64_t* words = new uint64_t[kWords]();
+			for (size_t k = 0; k < n; k++) {
+				words[l[k] / 64] |= uint64_t(1) << (l[k] % 64);
+			}
+			clause_t r;
+			r.size_ = static_cast<uint32_t>(n);
+			r.u_.words = words;
+			return r;
+		}
+
+		clause_t r;
+		std::copy(l, l + n, r.allocate(n));
+		return r;
+	}
+
+private:
+	uint32_t size_;
+	union {
+		uint32_t inline_lits[kInline];
+		uint32_t* heap;
+		uint64_t* words;
+	} u_;
+};
+
+#endif  // !DESHA256_SPARSE_CLAUSE_H_
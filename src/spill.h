@@ -0,0 +1,186 @@
+#ifndef DESHA256_SPILL_H_
+#define DESHA256_SPILL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DESHA256_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Process-wide memory budget for large arrays. Allocations are served from
+ * the heap while the bytes handed out stay within the budget; past it, each
+ * large allocation gets a deleted temporary file of its own, mapped shared.
+ * The kernel can then write those pages back to disk and drop them under
+ * memory pressure, so a job in a tight cgroup slows down instead of being
+ * OOM-killed. Without mmap (off POSIX) nothing spills and every allocation
+ * stays on the heap.
+ *
+ * The budget only covers what goes through SpillAllocator, i.e. the clause
+ * arrays of spill_vector. The literal arrays a SparseClause allocates on its
+ * own and the occurrence lists of SubsumptionIndex are neither counted nor
+ * spilled.
+ *
+ * $DESHA256_MEMORY_BUDGET sets the budget in bytes, with an optional K, M or
+ * G suffix (unlimited if unset). Files go to $DESHA256_SPILL_DIR, else
+ * $TMPDIR, else /tmp.
+ */
+class SpillArena {
+public:
+	static SpillArena& shared() {
+		static SpillArena arena(parse_budget(std::getenv("DESHA256_MEMORY_BUDGET")), spill_dir());
+		return arena;
+	}
+
+	SpillArena(size_t budget, std::string dir) : budget_(budget), dir_(std::move(dir)) {}
+
+	SpillArena(const SpillArena&) = delete;
+	SpillArena& operator=(const SpillArena&) = delete;
+
+	void* allocate(size_t bytes) {
+		const size_t total = bytes + kHeader;
+		if (bytes >= kMinSpill && resident_.load(std::memory_order_relaxed) + bytes > budget_.load(std::memory_order_relaxed)) {
+			if (void* p = map(total)) {
+				spilled_ += bytes;
+				return tag(p, kMapped);
+			}
+		}
+		void* p = std::malloc(total);
+		if (!p) {
+			throw std::bad_alloc();
+		}
+		resident_ += bytes;
+		return tag(p, kHeap);
+	}
+
+	/** p must come from allocate() with the same size. */
+	void deallocate(void* p, size_t bytes) {
+		char* base = static_cast<char*>(p) - kHeader;
+#ifdef DESHA256_HAVE_MMAP
+		if (*reinterpret_cast<const uint64_t*>(base) == kMapped) {
+			::munmap(base, bytes + kHeader);
+			spilled_ -= bytes;
+			return;
+		}
+#endif
+		std::free(base);
+		resident_ -= bytes;
+	}
+
+	void set_budget(size_t bytes) { budget_ = bytes; }
+	size_t budget() const { return budget_; }
+
+	/** Bytes currently held on the heap and in spill files. */
+	size_t resident() const { return resident_; }
+	size_t spilled() const { return spilled_; }
+
+	static size_t parse_budget(const char* s) {
+		if (!s || !*s) {
+			return SIZE_MAX;
+		}
+		char* end;
+		size_t n = std::strtoull(s, &end, 10);
+		switch (*end) {
+			case 'G':
+			case 'g':
+				n <<= 10;
+				[[fallthrough]];
+			case 'M':
+			case 'm':
+				n <<= 10;
+				[[fallthrough]];
+			case 'K':
+			case 'k':
+				n <<= 10;
+		}
+		return n;
+	}
+
+private:
+	/** Smaller allocations always stay on the heap; a file per allocation only pays off for big arrays. */
+	static constexpr size_t kMinSpill = size_t(1) << 20;
+	static constexpr size_t kHeader = alignof(std::max_align_t);
+	static constexpr uint64_t kHeap = 0, kMapped = 1;
+
+	static std::string spill_dir() {
+		for (const char* var : {"DESHA256_SPILL_DIR", "TMPDIR"}) {
+			if (const char* dir = std::getenv(var)) {
+				return dir;
+			}
+		}
+		return "/tmp";
+	}
+
+	/** Every block starts with a header saying where it came from. */
+	static void* tag(void* base, uint64_t kind) {
+		*static_cast<uint64_t*>(base) = kind;
+		return static_cast<char*>(base) + kHeader;
+	}
+
+	void* map(size_t bytes) {
+#ifndef DESHA256_HAVE_MMAP
+		(void)bytes;
+		return nullptr;
+#else
+		std::string path = dir_ + "/desha256-spill-XXXXXX";
+		const int fd = ::mkstemp(&path[0]);
+		if (fd < 0) {
+			return nullptr;
+		}
+		::unlink(path.c_str());
+
+		void* p = MAP_FAILED;
+		if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+			p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		return p == MAP_FAILED ? nullptr : p;
+#endif
+	}
+
+private:
+	std::atomic<size_t> budget_;
+	std::atomic<size_t> resident_{0};
+	std::atomic<size_t> spilled_{0};
+	const std::string dir_;
+};
+
+/** Standard allocator over SpillArena::shared(). */
+template <typename T>
+class SpillAllocator {
+public:
+	using value_type = T;
+
+	SpillAllocator() = default;
+	template <typename U>
+	SpillAllocator(const SpillAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(SpillArena::shared().allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n) {
+		SpillArena::shared().deallocate(p, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const SpillAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const SpillAllocator<U>&) const { return false; }
+};
+
+/** The clause set container of NormalForm. */
+template <typename T>
+using spill_vector = std::vector<T, SpillAllocator<T>>;
+
+#endif  // !DESHA256_SPILL_H_
@@ -0,0 +1,215 @@
+#ifndef DESHA256_SUBSUMPTION_H_
+#define DESHA256_SUBSUMPTION_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "spill.h"
+
+/**
+ * Clause set kept free of subsumed clauses (a clause is dropped when it
+ * includes another one). Every clause carries a 64-bit literal signature and
+ * is indexed twice:
+ *  - in the occurrence list of one of its literals, so the forward check
+ *    ("is x a superset of a stored clause?") visits each candidate once;
+ *  - in the occurrence lists of all of its literals, so the backward check
+ *    ("which stored clauses are supersets of x?") only scans the shortest
+ *    list among x's literals.
+ * Removed clauses are unlinked lazily while lists are scanned. Small sets,
+ * which are the common case, are scanned linearly and never allocate lists.
+ */
+template <typename ClauseT>
+class SubsumptionIndex {
+private:
+	using clause_t = ClauseT;
+	using clause_set_t = spill_vector<clause_t>;
+
+public:
+	/** num_literals is twice the number of variables. */
+	explicit SubsumptionIndex(size_t num_literals) : num_literals_(num_literals) {}
+
+	/** Adds x unless a stored clause subsumes it, removing the stored clauses it subsumes. */
+	bool insert(clause_t x, uint64_t sig) {
+		if (!indexed_) {
+			return insert_linear(std::move(x), sig);
+		}
+
+		lits_.clear();
+		x.for_each_literal([this](size_t lit) {
+			lits_.push_back(static_cast<uint32_t>(lit));
+		});
+
+		if (subsumed(x, sig)) {
+			return false;
+		}
+		remove_supersets(x, sig);
+
+		const uint32_t id = static_cast<uint32_t>(clauses_.size());
+		clauses_.push_back(std::move(x));
+		sigs_.push_back(sig);
+		alive_.push_back(1);
+		alive_count_++;
+		link(id);
+		return true;
+	}
+
+	size_t size() const { return alive_count_; }
+
+	/** Moves the surviving clauses out, in insertion order, compacting them in place so no second array is needed. */
+	clause_set_t take() {
+		size_t n = 0;
+		for (size_t i = 0; i < clauses_.size(); i++) {
+			if (alive_[i]) {
+				if (n != i) {
+					clauses_[n] = std::move(clauses_[i]);
+				}
+				n++;
+			}
+		}
+		clauses_.resize(n);
+		return std::move(clauses_);
+	}
+
+	~SubsumptionIndex() {}
+
+private:
+	static constexpr size_t kLinearLimit = 32;
+
+	bool insert_linear(clause_t x, uint64_t sig) {
+		for (size_t id = 0; id < clauses_.size(); id++) {
+			if (alive_[id] && (sigs_[id] & ~sig) == 0 && x.includes(clauses_[id])) {
+				return false;
+			}
+		}
+		for (size_t id = 0; id < clauses_.size(); id++) {
+			if (alive_[id] && (sig & ~sigs_[id]) == 0 && clauses_[id].includes(x)) {
+				kill(id);
+			}
+		}
+
+		clauses_.push_back(std::move(x));
+		sigs_.push_back(sig);
+		alive_.push_back(1);
+		alive_count_++;
+
+		if (alive_count_ > kLinearLimit) {
+			build();
+		}
+		return true;
+	}
+
+	void build() {
+		one_.resize(num_literals_);
+		all_.resize(num_literals_);
+		for (size_t id = 0; id < clauses_.size(); id++) {
+			if (!alive_[id]) {
+				continue;
+			}
+			lits_.clear();
+			clauses_[id].for_each_literal([this](size_t lit) {
+				lits_.push_back(static_cast<uint32_t>(lit));
+			});
+			link(static_cast<uint32_t>(id));
+		}
+		indexed_ = true;
+	}
+
+	/** Adds clause id, whose literals are in lits_, to the occurrence lists. */
+	void link(uint32_t id) {
+		if (lits_.empty()) {
+			empty_.push_back(id);
+			return;
+		}
+
+		uint32_t watch = lits_[0];
+		for (uint32_t lit : lits_) {
+			all_[lit].push_back(id);
+			if (one_[lit].size() < one_[watch].size()) {
+				watch = lit;
+			}
+		}
+		one_[watch].push_back(id);
+	}
+
+	bool subsumed(const clause_t& x, uint64_t sig) {
+		for (uint32_t id : empty_) {
+			if (alive_[id]) {
+				return true;
+			}
+		}
+		for (uint32_t lit : lits_) {
+			std::vector<uint32_t>& occ = one_[lit];
+			size_t j = 0;
+			bool found = false;
+			for (size_t i = 0; i < occ.size(); i++) {
+				const uint32_t id = occ[i];
+				if (!alive_[id]) {
+					continue;
+				}
+				occ[j++] = id;
+				if (!found && (sigs_[id] & ~sig) == 0 && x.includes(clauses_[id])) {
+					found = true;
+				}
+			}
+			occ.resize(j);
+			if (found) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void remove_supersets(const clause_t& x, uint64_t sig) {
+		if (lits_.empty()) {
+			for (size_t id = 0; id < alive_.size(); id++) {
+				kill(id);
+			}
+			return;
+		}
+
+		uint32_t best = lits_[0];
+		for (uint32_t lit : lits_) {
+			if (all_[lit].size() < all_[best].size()) {
+				best = lit;
+			}
+		}
+
+		std::vector<uint32_t>& occ = all_[best];
+		size_t j = 0;
+		for (size_t i = 0; i < occ.size(); i++) {
+			const uint32_t id = occ[i];
+			if (!alive_[id]) {
+				continue;
+			}
+			if ((sig & ~sigs_[id]) == 0 && clauses_[id].includes(x)) {
+				kill(id);
+				continue;
+			}
+			occ[j++] = id;
+		}
+		occ.resize(j);
+	}
+
+	void kill(size_t id) {
+		if (alive_[id]) {
+			alive_[id] = 0;
+			alive_count_--;
+		}
+	}
+
+private:
+	clause_set_t clauses_;
+	std::vector<uint64_t> sigs_;
+	std::vector<char> alive_;
+	size_t alive_count_ = 0;
+
+	size_t num_literals_;
+	bool indexed_ = false;
+	std::vector<std::vector<uint32_t>> one_;
+	std::vector<std::vector<uint32_t>> all_;
+	std::vector<uint32_t> empty_;
+	std::vector<uint32_t> lits_;
+};
+
+#endif  // !DESHA256_SUBSUMPTION_H_
@@ -0,0 +1,141 @@
+#ifndef DESHA256_THREAD_POOL_H_
+#define DESHA256_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running one parallel_for() at a time. The
+ * calling thread takes part in the loop, and a parallel_for() issued from
+ * inside a task runs inline, so nesting cannot deadlock.
+ */
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+		for (size_t i = 1; i < std::max<size_t>(threads, 1); i++) {
+			workers_.emplace_back([this] { work(); });
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/** Pool shared by the whole process, sized to the hardware unless DESHA256_THREADS says otherwise. */
+	static ThreadPool& shared() {
+		static ThreadPool pool([] {
+			const char* env = std::getenv("DESHA256_THREADS");
+			return env ? static_cast<size_t>(std::strtoul(env, nullptr, 10)) : std::thread::hardware_concurrency();
+		}());
+		return pool;
+	}
+
+	/** Number of threads a parallel_for() runs on, the caller included. */
+	size_t size() const { return workers_.size() + 1; }
+
+	/** Calls fn(k) for every k in [0, n) and returns when all calls are done. */
+	void parallel_for(size_t n, const std::function<void(size_t)>& fn) {
+		if (in_task_ || workers_.empty() || n <= 1) {
+			for (size_t k = 0; k < n; k++) {
+				fn(k);
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> job_lock(job_mutex_);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			fn_ = &fn;
+			n_ = n;
+			next_ = 0;
+			pending_ = n;
+			generation_++;
+		}
+		wake_.notify_all();
+
+		run_tasks(fn, n);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this] { return pending_ == 0 && active_ == 0; });
+		fn_ = nullptr;
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread& t : workers_) {
+			t.join();
+		}
+	}
+
+private:
+	void work() {
+		size_t seen = 0;
+		for (;;) {
+			const std::function<void(size_t)>* fn;
+			size_t n;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+				if (stop_) {
+					return;
+				}
+				seen = generation_;
+				if (!fn_) {
+					continue;
+				}
+				fn = fn_;
+				n = n_;
+				active_++;
+			}
+
+			run_tasks(*fn, n);
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--active_ == 0 && pending_ == 0) {
+				done_.notify_all();
+			}
+		}
+	}
+
+	void run_tasks(const std::function<void(size_t)>& fn, size_t n) {
+		in_task_ = true;
+		for (;;) {
+			const size_t k = next_.fetch_add(1);
+			if (k >= n) {
+				break;
+			}
+			fn(k);
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--pending_ == 0 && active_ == 0) {
+				done_.notify_all();
+			}
+		}
+		in_task_ = false;
+	}
+
+private:
+	inline static thread_local bool in_task_ = false;
+
+	std::vector<std::thread> workers_;
+	std::mutex job_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_, done_;
+	const std::function<void(size_t)>* fn_ = nullptr;
+	size_t n_ = 0;
+	std::atomic<size_t> next_{0};
+	size_t pending_ = 0;
+	size_t active_ = 0;
+	size_t generation_ = 0;
+	bool stop_ = false;
+};
+
+#endif  // !DESHA256_THREAD_POOL_H_
@@ -0,0 +1,243 @@
+#ifndef DESHA256_TSEITIN_H_
+#define DESHA256_TSEITIN_H_
+
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+
+#include "bit.h"
+#include "context_stack.h"
+
+/** Literal of a Tseitin encoding: variable times two, plus one if negated. Variable 0 is the constant. */
+class CnfLit {
+public:
+	constexpr CnfLit() : lit_(0) {}
+	constexpr explicit CnfLit(uint32_t lit) : lit_(lit) {}
+	constexpr CnfLit(uint32_t var, bool negated) : lit_((var << 1) | (negated ? 1 : 0)) {}
+
+	constexpr uint32_t raw() const { return lit_; }
+	constexpr uint32_t var() const { return lit_ >> 1; }
+	constexpr bool negated() const { return lit_ & 1; }
+	constexpr bool is_const() const { return var() == 0; }
+
+	/** Signed DIMACS literal; only meaningful for non-constant literals. */
+	constexpr int dimacs() const { return negated() ? -static_cast<int>(var()) : static_cast<int>(var()); }
+
+	constexpr CnfLit operator~() const { return CnfLit(lit_ ^ 1); }
+
+	constexpr bool operator==(const CnfLit& other) const { return lit_ == other.lit_; }
+	constexpr bool operator!=(const CnfLit& other) const { return lit_ != other.lit_; }
+
+	static constexpr CnfLit zero() { return CnfLit(0); }
+	static constexpr CnfLit one() { return CnfLit(1); }
+
+private:
+	uint32_t lit_;
+};
+
+/** Consumer of the clauses produced by a CnfEncoder, as signed DIMACS literals. */
+class ClauseSink {
+public:
+	virtual void add_clause(const int* lits, size_t n) = 0;
+	virtual ~ClauseSink() {}
+};
+
+/**
+ * Streams clauses to a DIMACS file as they arrive. The problem line is written
+ * as a fixed-width placeholder and patched in place by close().
+ */
+class DimacsWriter : public ClauseSink {
+public:
+	explicit DimacsWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc) {
+		out_ << std::string(kHeaderWidth - 1, ' ') << '\n';
+	}
+
+	bool good() const { return out_.good(); }
+
+	void comment(const std::string& text) {
+		out_ << "c " << text << '\n';
+	}
+
+	void add_clause(const int* lits, size_t n) override {
+		char buf[16];
+		for (size_t i = 0; i < n; i++) {
+			char* end = std::to_chars(buf, buf + sizeof(buf), lits[i]).ptr;
+			*end++ = ' ';
+			out_.write(buf, end - buf);
+		}
+		out_.write("0\n", 2);
+		clauses_++;
+	}
+
+	size_t num_clauses() const { return clauses_; }
+
+	/** Patches the problem line and flushes the file. */
+	void close(size_t num_vars) {
+		std::string header = "p cnf " + std::to_string(num_vars) + ' ' + std::to_string(clauses_);
+		header.resize(kHeaderWidth - 1, ' ');
+		out_.seekp(0);
+		out_ << header;
+		out_.close();
+	}
+
+	~DimacsWriter() {}
+
+private:
+	static constexpr size_t kHeaderWidth = 48;
+
+	std::ofstream out_;
+	size_t clauses_ = 0;
+};
+
+/**
+ * Linear-size Tseitin encoder. Every non-trivial gate gets a fresh variable
+ * and its defining clauses are handed to the sink immediately, so nothing but
+ * the literals held by live Bit<CnfLit> values stays in memory. Inputs are
+ * variables 1..num_inputs.
+ *
+ * Bit<CnfLit> encodes into CnfEncoder::current(), the most recently
+ * constructed live encoder.
+ */
+class CnfEncoder : public ContextStack<CnfEncoder> {
+public:
+	CnfEncoder(ClauseSink& sink, size_t num_inputs) : sink_(sink), inputs_(num_inputs), vars_(static_cast<uint32_t>(num_inputs)) {}
+
+	CnfEncoder(const CnfEncoder&) = delete;
+	CnfEncoder& operator=(const CnfEncoder&) = delete;
+
+	static CnfEncoder& current() {
+		assert(innermost() && "no live CnfEncoder");
+		return *innermost();
+	}
+
+	CnfLit input(size_t i) const {
+		assert(i < inputs_);
+		return CnfLit(static_cast<uint32_t>(i + 1), false);
+	}
+
+	CnfLit and_(CnfLit a, CnfLit b) {
+		if (a == CnfLit::zero() || b == CnfLit::zero() || a == ~b) {
+			return CnfLit::zero();
+		}
+		if (a == CnfLit::one() || a == b) {
+			return b;
+		}
+		if (b == CnfLit::one()) {
+			return a;
+		}
+
+		const CnfLit z = fresh();
+		clause({~z, a});
+		clause({~z, b});
+		clause({z, ~a, ~b});
+		return z;
+	}
+
+	CnfLit or_(CnfLit a, CnfLit b) {
+		return ~and_(~a, ~b);
+	}
+
+	CnfLit xor_(CnfLit a, CnfLit b) {
+		if (a.is_const()) {
+			return a.negated() ? ~b : b;
+		}
+		if (b.is_const()) {
+			return b.negated() ? ~a : a;
+		}
+		if (a == b) {
+			return CnfLit::zero();
+		}
+		if (a == ~b) {
+			return CnfLit::one();
+		}
+
+		const CnfLit z = fresh();
+		clause({~z, a, b});
+		clause({~z, ~a, ~b});
+		clause({z, ~a, b});
+		clause({z, a, ~b});
+		return z;
+	}
+
+	CnfLit ite(CnfLit s, CnfLit d1, CnfLit d0) {
+		if (s.is_const()) {
+			return s.negated() ? d1 : d0;
+		}
+		if (d1 == d0) {
+			return d1;
+		}
+		if (d1.is_const() || d0.is_const() || d1 == ~d0) {
+			return or_(and_(s, d1), and_(~s, d0));
+		}
+
+		const CnfLit z = fresh();
+		clause({~s, ~d1, z});
+		clause({~s, d1, ~z});
+		clause({s, ~d0, z});
+		clause({s, d0, ~z});
+		return z;
+	}
+
+	/** Pins a literal, e.g. a digest bit returned by Sha256::Finalize(), to a value. */
+	void constrain(CnfLit a, bool value) {
+		if (!value) {
+			a = ~a;
+		}
+		if (a == CnfLit::one()) {
+			return;
+		}
+		if (a == CnfLit::zero()) {
+			sink_.add_clause(nullptr, 0);
+			return;
+		}
+		clause({a});
+	}
+
+	size_t num_inputs() const { return inputs_; }
+	size_t num_vars() const { return vars_; }
+
+private:
+	CnfLit fresh() {
+		return CnfLit(++vars_, false);
+	}
+
+	void clause(std::initializer_list<CnfLit> lits) {
+		int buf[3];
+		size_t n = 0;
+		for (const CnfLit& l : lits) {
+			buf[n++] = l.dimacs();
+		}
+		sink_.add_clause(buf, n);
+	}
+
+private:
+	ClauseSink& sink_;
+	size_t inputs_;
+	uint32_t vars_;
+};
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_zero() { return CnfLit::zero(); }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_one() { return CnfLit::one(); }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_not(const CnfLit& a) { return ~a; }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_and(const CnfLit& a, const CnfLit& b) { return CnfEncoder::current().and_(a, b); }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_or(const CnfLit& a, const CnfLit& b) { return CnfEncoder::current().or_(a, b); }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_xor(const CnfLit& a, const CnfLit& b) { return CnfEncoder::current().xor_(a, b); }
+
+template <>
+inline CnfLit Bit<CnfLit>::raw_ite(const CnfLit& s, const CnfLit& d1, const CnfLit& d0) { return CnfEncoder::current().ite(s, d1, d0); }
+
+#endif  // !DESHA256_TSEITIN_H_
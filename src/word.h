@@ -4,7 +4,10 @@
 #include <algorithm>
 #include <array>
 #include <bitset>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
+#include <vector>
 
 #include "bit.h"
 
@@ -106,22 +109,64 @@ public:
 		return *this;
 	}
 
-	word_t operator+(const word_t& other) const {
+	/** a + b through the given carry-propagate adder. */
+	static word_t add(const word_t& a, const word_t& b, AdderKind kind = AdderTraits<T>::kind) {
+		switch (kind) {
+			case AdderKind::kogge_stone:
+			case AdderKind::brent_kung:
+				return prefix_add(a, b, kind);
+			case AdderKind::ripple:
+				break;
+		}
+
 		bit_t c = bit_t::zero();
 
 		word_t r;
 
 		for (int i = N - 1; i >= 0; i--) {
-			bit_t AxorB = data_[i] ^ other.data_[i];
+			bit_t AxorB = a.data_[i] ^ b.data_[i];
 			r.data_[i] = AxorB ^ c;
 			if (i != 0) {
-				c = (AxorB & c) | (data_[i] & other.data_[i]);
+				c = (AxorB & c) | (a.data_[i] & b.data_[i]);
 			}
 		}
 
 		return r;
 	}
+
+	/**
+	 * Sum of any number of words: a carry-save tree of full-adder rows brings
+	 * them down to two (Wallace-style, three rows into two per level), and a
+	 * single carry-propagate adder finishes.
+	 */
+	static word_t sum(std::initializer_list<word_t> terms, AdderKind kind = AdderTraits<T>::kind) {
+		std::vector<word_t> rows(terms);
+		while (rows.size() > 2) {
+			std::vector<word_t> next;
+			size_t i = 0;
+			for (; i + 3 <= rows.size(); i += 3) {
+				next.emplace_back();
+				next.emplace_back();
+				carry_save(rows[i], rows[i + 1], rows[i + 2], next[next.size() - 2], next.back());
+			}
+			next.insert(next.end(), rows.begin() + i, rows.end());
+			rows.swap(next);
+		}
+
+		if (rows.empty()) {
+			return word_t(0ull);
+		}
+		return rows.size() == 1 ? rows[0] : add(rows[0], rows[1], kind);
+	}
+
+	word_t operator+(const word_t& other) const {
+		return add(*this, other);
+	}
 	word_t& operator+=(const word_t& other) {
+		if (AdderTraits<T>::kind != AdderKind::ripple) {
+			return *this = add(*this, other);
+		}
+
 		bit_t c = bit_t::zero();
 
 		for (int i = N - 1; i >= 0; i--) {
@@ -216,6 +261,70 @@ public:
 	~Word() {}
 
 private:
+	/** One carry-save row: s gets the bitwise sums, c the carries moved one place up. */
+	static void carry_save(const word_t& a, const word_t& b, const word_t& x, word_t& s, word_t& c) {
+		c.data_[N - 1] = bit_t::zero();
+		for (size_t i = 0; i < N; i++) {
+			const bit_t AxorB = a.data_[i] ^ b.data_[i];
+			s.data_[i] = AxorB ^ x.data_[i];
+			if (i != 0) {
+				c.data_[i - 1] = (a.data_[i] & b.data_[i]) | (x.data_[i] & AxorB);
+			}
+		}
+	}
+
+	/**
+	 * Parallel-prefix adder over generate/propagate pairs, indexed from the
+	 * least significant bit. Kogge-Stone combines every position at every
+	 * level (log N depth, N log N cells); Brent-Kung does an up-sweep and a
+	 * down-sweep (2 log N depth, about 2N cells). The carry out of the top bit
+	 * is never needed, so that position is left out.
+	 */
+	static word_t prefix_add(const word_t& a, const word_t& b, AdderKind kind) {
+		std::array<bit_t, N> g, p, G, P;
+		for (size_t i = 0; i < N; i++) {
+			g[i] = a.data_[N - 1 - i] & b.data_[N - 1 - i];
+			p[i] = a.data_[N - 1 - i] ^ b.data_[N - 1 - i];
+		}
+		G = g;
+		P = p;
+
+		auto combine = [&G, &P](size_t i, size_t j, bool need_p) {
+			G[i] = G[i] | (P[i] & G[j]);
+			if (need_p) {
+				P[i] = P[i] & P[j];
+			}
+		};
+
+		if (kind == AdderKind::kogge_stone) {
+			for (size_t d = 1; d < N - 1; d *= 2) {
+				for (size_t i = N - 2; i >= d; i--) {
+					combine(i, i - d, 2 * d < N - 1);
+				}
+			}
+		} else {
+			size_t top = 1;
+			for (size_t d = 1; d < N - 1; d *= 2) {
+				for (size_t i = 2 * d - 1; i < N - 1; i += 2 * d) {
+					combine(i, i - d, true);
+				}
+				top = d;
+			}
+			for (size_t d = top / 2; d >= 1; d /= 2) {
+				for (size_t i = 3 * d - 1; i < N - 1; i += 2 * d) {
+					combine(i, i - d, false);
+				}
+			}
+		}
+
+		word_t r;
+		r.data_[N - 1] = p[0];
+		for (size_t i = 1; i < N; i++) {
+			r.data_[N - 1 - i] = p[i] ^ G[i - 1];
+		}
+		return r;
+	}
+
 	template <typename U, typename Fn>
 	inline static U transform(const U& a, Fn fn) {
 		U r;
@@ -244,6 +353,168 @@ private:
 	std::array<Bit<T>, N> data_;
 };
 
+/**
+ * Concrete 32-bit word packed into a native integer; index 0 is still the most
+ * significant bit. Bits are exposed by value (or through a proxy reference), so
+ * there is no begin()/end()/data() over Bit<bool> storage.
+ */
+template <>
+class Word<bool, 32> {
+private:
+	static constexpr size_t N = 32;
+	using bit_t = Bit<bool>;
+	using array_t = std::array<bit_t, N>;
+	using word_t = Word<bool, N>;
+
+public:
+	class reference {
+	public:
+		reference(uint32_t& word, uint32_t mask) : word_(word), mask_(mask) {}
+
+		operator bit_t() const { return value(); }
+		bool value() const { return (word_ & mask_) != 0; }
+
+		reference& operator=(const bit_t& b) {
+			word_ = b.value() ? (word_ | mask_) : (word_ & ~mask_);
+			return *this;
+		}
+		reference& operator=(const reference& other) {
+			return *this = bit_t(other.value());
+		}
+
+	private:
+		uint32_t& word_;
+		uint32_t mask_;
+	};
+
+	Word() : data_(0) {}
+	Word(const word_t& other) : data_(other.data_) {}
+	Word(const array_t& data) : data_(0) {
+		for (size_t i = 0; i < N; i++) {
+			data_ = (data_ << 1) | (data[i].value() ? 1u : 0u);
+		}
+	}
+	Word(const std::bitset<N>& bs) : data_(static_cast<uint32_t>(bs.to_ulong())) {}
+	Word(unsigned long long n) : data_(static_cast<uint32_t>(n)) {}
+
+	size_t size() const noexcept { return N; }
+
+	uint32_t value() const noexcept { return data_; }
+
+	reference operator[](size_t i) { return reference(data_, mask(i)); }
+	bit_t operator[](size_t i) const { return (data_ & mask(i)) != 0; }
+
+	static word_t not_(const word_t& a) { return make(~a.data_); }
+	static word_t and_(const word_t& a, const word_t& b) { return make(a.data_ & b.data_); }
+	static word_t or_(const word_t& a, const word_t& b) { return make(a.data_ | b.data_); }
+	static word_t xor_(const word_t& a, const word_t& b) { return make(a.data_ ^ b.data_); }
+
+	static word_t nand(const word_t& a, const word_t& b) { return make(~(a.data_ & b.data_)); }
+	static word_t nor(const word_t& a, const word_t& b) { return make(~(a.data_ | b.data_)); }
+	static word_t xnor(const word_t& a, const word_t& b) { return make(~(a.data_ ^ b.data_)); }
+
+	static word_t impl(const word_t& p, const word_t& q) { return make(~p.data_ | q.data_); }
+	static word_t ite(const bit_t& s, const word_t& d1, const word_t& d0) { return s.value() ? d1 : d0; }
+
+	static void not_eq (word_t & a) { a.data_ = ~a.data_; }
+	static void and_eq (word_t & a, const word_t& b) { a.data_ &= b.data_; }
+	static void or_eq (word_t & a, const word_t& b) { a.data_ |= b.data_; }
+	static void xor_eq (word_t & a, const word_t& b) { a.data_ ^= b.data_; }
+
+	word_t& operator=(const word_t& other) {
+		data_ = other.data_;
+		return *this;
+	}
+	word_t& operator=(const array_t& arr) {
+		return *this = word_t(arr);
+	}
+
+	word_t operator~() const { return make(~data_); }
+	word_t operator&(const word_t& other) const { return make(data_ & other.data_); }
+	word_t operator|(const word_t& other) const { return make(data_ | other.data_); }
+	word_t operator^(const word_t& other) const { return make(data_ ^ other.data_); }
+
+	word_t& operator&=(const word_t& other) {
+		data_ &= other.data_;
+		return *this;
+	}
+	word_t& operator|=(const word_t& other) {
+		data_ |= other.data_;
+		return *this;
+	}
+	word_t& operator^=(const word_t& other) {
+		data_ ^= other.data_;
+		return *this;
+	}
+
+	/** Native addition; the adder kind only matters to symbolic backends. */
+	static word_t add(const word_t& a, const word_t& b, AdderKind = AdderKind::ripple) { return make(a.data_ + b.data_); }
+	static word_t sum(std::initializer_list<word_t> terms, AdderKind = AdderKind::ripple) {
+		uint32_t r = 0;
+		for (const word_t& t : terms) {
+			r += t.data_;
+		}
+		return make(r);
+	}
+
+	word_t operator+(const word_t& other) const { return make(data_ + other.data_); }
+	word_t& operator+=(const word_t& other) {
+		data_ += other.data_;
+		return *this;
+	}
+
+	word_t& operator++() {
+		++data_;
+		return *this;
+	}
+
+	word_t operator-() const { return make(0u - data_); }
+	word_t operator-(const word_t& other) const { return make(data_ - other.data_); }
+
+	word_t operator>>(size_t n) const { return make(n < N ? data_ >> n : 0u); }
+	word_t& operator>>=(size_t n) {
+		data_ = n < N ? data_ >> n : 0u;
+		return *this;
+	}
+
+	word_t operator<<(size_t n) const { return make(n < N ? data_ << n : 0u); }
+	word_t& operator<<=(size_t n) {
+		data_ = n < N ? data_ << n : 0u;
+		return *this;
+	}
+
+	word_t rot_r(size_t n) const { return make(rotr(data_, n)); }
+	word_t& rot_r_eq(size_t n) {
+		data_ = rotr(data_, n);
+		return *this;
+	}
+
+	word_t rot_l(size_t n) const { return make(rotr(data_, N - n % N)); }
+	word_t& rot_l_eq(size_t n) {
+		data_ = rotr(data_, N - n % N);
+		return *this;
+	}
+
+	~Word() {}
+
+private:
+	static constexpr uint32_t mask(size_t i) { return uint32_t(1) << (N - i - 1); }
+
+	static constexpr uint32_t rotr(uint32_t x, size_t n) {
+		n %= N;
+		return n ? (x >> n) | (x << (N - n)) : x;
+	}
+
+	static word_t make(uint32_t x) {
+		word_t r;
+		r.data_ = x;
+		return r;
+	}
+
+private:
+	uint32_t data_;
+};
+
 template <typename T, typename U>
 constexpr Word<T, sizeof(U) * 8> unpackbits(const U& n) {
 	constexpr size_t N = sizeof(U) * 8;